@@ -209,22 +209,22 @@ void DecompileDialog::_PopulateScripts()
 	SetRedraw(FALSE);
 	m_wndListScripts.DeleteAllItems();
 
-	auto scriptResources = _helper.Resources(ResourceTypeFlags::Script, ResourceEnumFlags::MostRecentOnly | ResourceEnumFlags::NameLookups);
+	auto scriptResources = _helper.Resources(ResourceTypeFlags::Script, ResourceEnumFlags::MostRecentOnly);
 	int itemNumber = 0;
-	for (auto &blob : *scriptResources)
+	for (const ResourceHeaderRecord &record : scriptResources->Headers())
 	{
-		string name = blob->GetName();
+		string name = _helper.FigureOutName(ResourceType::Script, record.GetNumber(), record.GetBase36());
 		LVITEM item = {};
 		item.mask = LVIF_TEXT | LVIF_PARAM;
 		item.pszText = const_cast<LPSTR>(name.c_str());
 		item.iItem = itemNumber;
 		item.iSubItem = NameColumn;
-		item.lParam = blob->GetNumber();	// associated data is the script number
+		item.lParam = record.GetNumber();	// associated data is the script number
 		m_wndListScripts.InsertItem(&item);
 
 		item.mask = LVIF_TEXT;
 		item.iSubItem = NumberColumn;
-		string scriptNumString = fmt::format("{0}", blob->GetNumber());
+		string scriptNumString = fmt::format("{0}", record.GetNumber());
 		item.pszText = const_cast<LPSTR>(scriptNumString.c_str());
 		m_wndListScripts.SetItem(&item);
 
@@ -32,6 +32,7 @@ CGamePropertiesDialog::CGamePropertiesDialog(RunLogic &runLogic, CWnd* pParent /
 	_fPatchFileStart = appState->GetResourceMap().Helper().GetResourceSaveLocation(ResourceSaveLocation::Default) == ResourceSaveLocation::Patch;
 	_fUnditherStart = appState->GetResourceMap().Helper().GetUndither();
 	_fNoDbugStr = appState->GetResourceMap().Helper().GetNoDbugStr();
+	_fCompressResourcesStart = appState->GetResourceMap().Helper().GetCompressResources();
 }
 
 CGamePropertiesDialog::~CGamePropertiesDialog()
@@ -82,6 +83,15 @@ void CGamePropertiesDialog::DoDataExchange(CDataExchange* pDX)
 	DDX_Control(pDX, IDC_NO_DBUGSTR_CALLS, m_wndCheckNoDbugStr);
 	m_wndCheckNoDbugStr.SetCheck(_fNoDbugStr ? BST_CHECKED : BST_UNCHECKED);
 
+	DDX_Control(pDX, IDC_CHECKCOMPRESSRESOURCES, m_wndCheckCompressResources);
+	m_wndCheckCompressResources.SetCheck(_fCompressResourcesStart ? BST_CHECKED : BST_UNCHECKED);
+	ResourcePackageFormat packageFormat = appState->GetResourceMap().GetSCIVersion().PackageFormat;
+	if ((packageFormat != ResourcePackageFormat::SCI0) && (packageFormat != ResourcePackageFormat::SCI1) && (packageFormat != ResourcePackageFormat::SCI11))
+	{
+		// We don't have encoders for the later compression methods (STACpack)
+		m_wndCheckCompressResources.EnableWindow(FALSE);
+	}
+
 	if (!_initialized)
 	{
 		_initialized = true;
@@ -215,6 +225,12 @@ void CGamePropertiesDialog::OnOK()
 		appState->GetResourceMap().Helper().SetNoDbugStr(noDbugStr);
 	}
 
+	bool compressResources = m_wndCheckCompressResources.GetCheck() == BST_CHECKED;
+	if (compressResources != _fCompressResourcesStart)
+	{
+		appState->GetResourceMap().Helper().SetCompressResources(compressResources);
+	}
+
 	bool usePatchFiles = m_wndCheckPatchFiles.GetCheck() == BST_CHECKED;
 	if (usePatchFiles != _fPatchFileStart)
 	{
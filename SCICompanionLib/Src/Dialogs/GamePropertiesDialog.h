@@ -58,6 +58,7 @@ private:
 	CExtCheckBox m_wndCheckPatchFiles;
 	CExtCheckBox m_wndCheckUnditherEGA;
 	CExtCheckBox m_wndCheckNoDbugStr;
+	CExtCheckBox m_wndCheckCompressResources;
 
 	std::unordered_map<std::string, std::string> _optionToExe;
 	std::unordered_map<std::string, std::string> _optionToParams;
@@ -70,6 +71,7 @@ private:
 	bool _wasAspectRatioChanged;
 	bool _fUnditherStart;
 	bool _fNoDbugStr;
+	bool _fCompressResourcesStart;
 
 	bool _gameNeedsReload;
 
@@ -47,11 +47,11 @@ GenerateDocsDialog::~GenerateDocsDialog()
 void GenerateDocsDialog::_PopulateScripts()
 {
 	m_wndScripts.SetRedraw(FALSE);
-	auto scriptResources = _helper.Resources(ResourceTypeFlags::Script, ResourceEnumFlags::MostRecentOnly | ResourceEnumFlags::NameLookups | ResourceEnumFlags::AddInDefaultEnumFlags);
+	auto scriptResources = _helper.Resources(ResourceTypeFlags::Script, ResourceEnumFlags::MostRecentOnly | ResourceEnumFlags::AddInDefaultEnumFlags);
 	int itemNumber = 0;
-	for (auto &blob : *scriptResources)
+	for (const ResourceHeaderRecord &record : scriptResources->Headers())
 	{
-		std::string name = blob->GetName();
+		std::string name = _helper.FigureOutName(ResourceType::Script, record.GetNumber(), record.GetBase36());
 		m_wndScripts.InsertItem(-1, name.c_str());
 	}
 	m_wndScripts.SetRedraw(TRUE);
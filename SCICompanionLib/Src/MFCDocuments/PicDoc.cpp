@@ -50,11 +50,14 @@ END_MESSAGE_MAP()
 
 // CPicDoc construction/destruction
 
-CPicDoc::CPicDoc() : _previewPalette(nullptr), _showPolygons(false), _currentPolyIndex(-1), _fakeEgoResourceNumber(-1), _dependencyTracker(nullptr), _isUndithered(false)
+CPicDoc::CPicDoc() : _previewPalette(nullptr), _showPolygons(false), _currentPolyIndex(-1), _fakeEgoResourceNumber(-1), _dependencyTracker(nullptr), _isUndithered(false), _editedFrom(-1)
 {
 	// Add ourselves as a sync
 	CResourceMap &map = appState->GetResourceMap();
 	map.AddSync(this);
+
+	// So clicking in history mode is quick.
+	_pdm.SetTrackWriters(true);
 }
 
 CPicDoc::~CPicDoc()
@@ -345,8 +348,10 @@ void CPicDoc::InsertCommand(PicCommand *pCommand)
 	ptrdiff_t delta = 0;
 	ptrdiff_t pos = _pdm.GetPos();
 	ApplyChangesWithPost<PicComponent>(
-		[pCommand, &delta, pos](PicComponent &pic)
+		[this, pCommand, &delta, pos](PicComponent &pic)
 	{
+		// Inserting can also remove the command before (see ::InsertCommands)
+		_editedFrom = max((ptrdiff_t)0, ((pos == -1) ? (ptrdiff_t)pic.commands.size() : pos) - 1);
 		delta = ::InsertCommands(pic, pos, 1, pCommand);
 		return WrapHint(PicChangeHint::EditPicInvalid | PicChangeHint::EditPicPos);
 	},
@@ -362,8 +367,9 @@ void CPicDoc::InsertCommands(INT_PTR iStart, INT_PTR cCount, PicCommand *pComman
 	INT_PTR iPos = _pdm.GetPos();
 
 	ApplyChangesWithPost<PicComponent>(
-		[iStart, cCount, pCommands](PicComponent &pic)
+		[this, iStart, cCount, pCommands](PicComponent &pic)
 	{
+		_editedFrom = max((ptrdiff_t)0, ((iStart == -1) ? (ptrdiff_t)pic.commands.size() : iStart) - 1);
 		::InsertCommands(pic, iStart, cCount, pCommands);
 		return WrapHint(PicChangeHint::EditPicInvalid | PicChangeHint::EditPicPos);
 	},
@@ -386,8 +392,9 @@ void CPicDoc::RemoveCommand(INT_PTR iCommandIndex)
 {
 	INT_PTR iPos = _pdm.GetPos();
 	ApplyChangesWithPost<PicComponent>(
-		[iCommandIndex](PicComponent &pic)
+		[this, iCommandIndex](PicComponent &pic)
 	{
+		_editedFrom = iCommandIndex;
 		::RemoveCommand(pic, iCommandIndex);
 		return WrapHint(PicChangeHint::EditPicInvalid | PicChangeHint::EditPicPos);
 	},
@@ -411,8 +418,9 @@ void CPicDoc::RemoveCommandRange(INT_PTR iStart, INT_PTR iEnd)
 	INT_PTR iPos = _pdm.GetPos();
 
 	ApplyChangesWithPost<PicComponent>(
-		[iStart, iEnd](PicComponent &pic)
+		[this, iStart, iEnd](PicComponent &pic)
 	{
+		_editedFrom = iStart;
 		::RemoveCommandRange(pic, iStart, iEnd);
 		return WrapHint(PicChangeHint::EditPicInvalid | PicChangeHint::EditPicPos);
 	},
@@ -483,8 +491,17 @@ void CPicDoc::PostApplyChanges(CObject *pObj)
 		RefreshPaletteOptions();
 	}
 
-	// Invalidate our pic before we update views..
-	_pdm.Invalidate();
+	// Invalidate our pic before we update views. If we know where the edit was, the draw manager can keep
+	// what it drew before that.
+	if (_editedFrom != -1)
+	{
+		_pdm.InvalidateFrom(_editedFrom);
+		_editedFrom = -1;
+	}
+	else
+	{
+		_pdm.Invalidate();
+	}
 }
 
 bool CPicDoc::v_IsVGA()
@@ -190,6 +190,7 @@ private:
 	bool _showPolygons;
 
 	bool _isUndithered;
+	ptrdiff_t _editedFrom;	// The first command changed by the current edit, or -1 if we don't know.
 
 	DependencyTracker *_dependencyTracker;
 	std::unique_ptr<PolygonComponent> _lastPoly;
@@ -15,9 +15,22 @@
 #include "UndoResource.h"
 #include "ResourceDocument.h"
 #include "ResourceEntity.h"
+#include "ResourceUndoDelta.h"
 
 void DoNothing(ResourceEntity &resource);
 
+class ResourceEntityUndoDelta : public IUndoDelta<ResourceEntity>
+{
+public:
+	ResourceEntityUndoDelta(std::unique_ptr<ResourceUndoDelta> delta) : _delta(std::move(delta)) {}
+
+	void Apply(ResourceEntity &item) const override { _delta->Apply(item); }
+	size_t GetSize() const override { return _delta->GetSize(); }
+
+private:
+	std::unique_ptr<ResourceUndoDelta> _delta;
+};
+
 //
 // Modifications to resource documents should be done via ApplyChanges. The functions passed to
 // ApplyChanges are given components from a clone of the resource. This means that undo functionality
@@ -130,6 +143,22 @@ public:
 		return modified;
 	}
 
+	std::unique_ptr<IUndoDelta<ResourceEntity>> v_CreateUndoDelta(const ResourceEntity &before, const ResourceEntity &after) override
+	{
+		std::unique_ptr<ResourceUndoDelta> delta = ResourceUndoDelta::Create(before, after);
+		if (delta)
+		{
+			return std::make_unique<ResourceEntityUndoDelta>(std::move(delta));
+		}
+		return nullptr;
+	}
+
+	size_t v_GetUndoSize(const ResourceEntity &item) override
+	{
+		size_t size = GetApproximateResourceSize(item);
+		return size ? size : __super::v_GetUndoSize(item);
+	}
+
 	void _OnSuccessfulSave(const ResourceEntity *pResource) override
 	{
 		SetLastSaved(pResource);
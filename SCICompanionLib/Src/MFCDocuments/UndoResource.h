@@ -19,9 +19,29 @@
 // _TItem is the resource type
 // ptrdiff_t is any extra info (like cursor position) you wish to include with the undo snapshot
 //
+// If the document can describe the difference between two resources (v_CreateUndoDelta), then only
+// every so often do we keep a whole copy of the resource (a keyframe). The frames in between just
+// store the delta from the previous frame, and are rebuilt from the nearest keyframe when needed.
+// Since items are changed after they are added to the undo stack (see ResourceEntityDocument::ApplyChanges),
+// the delta for the last frame isn't worked out until another is added.
+//
 
 #define MAX_UNDO 100
-#define AGGRESSIVITY_UNDO 30
+// Roughly how much memory the undo stack for one document can use.
+#define UNDO_BUDGET (32 * 1024 * 1024)
+// How often we keep a whole copy of the resource, so undo doesn't need to apply too many deltas.
+#define UNDO_KEYFRAME_INTERVAL 16
+
+template <class _TItem>
+class IUndoDelta
+{
+public:
+	virtual ~IUndoDelta() {}
+
+	// Turns the previous frame's item into this one.
+	virtual void Apply(_TItem &item) const = 0;
+	virtual size_t GetSize() const = 0;
+};
 
 template <class _TBase, class _TItem>
 class CUndoResource : public _TBase
@@ -29,20 +49,36 @@ class CUndoResource : public _TBase
 private:
 	struct UndoData
 	{
-		UndoData(std::unique_ptr<_TItem>&& theItem, ptrdiff_t theExtra)
+		UndoData(std::unique_ptr<_TItem>&& theItem, ptrdiff_t theExtra, uint32_t theId)
 		{
 			item = std::move(theItem);
 			extra = theExtra;
+			id = theId;
+			size = 0;
+			isKeyframe = false;
+			pending = true;
 		}
 
-		std::unique_ptr<_TItem> item;
+		std::unique_ptr<_TItem> item;						// Only kept for keyframes and the frames around the current one
+		std::unique_ptr<IUndoDelta<_TItem>> delta;		// From the previous frame
 		ptrdiff_t extra;
+		uint32_t id;
+		size_t size;
+		bool isKeyframe;
+		bool pending;										// We haven't worked out the delta yet
 	};
 
 protected:
 	// Implementors can override to attach extra data to a resource in the undo stack
 	virtual ptrdiff_t v_GetExtra() { return 0; }
 
+	// Implementors can override to store the difference between resources instead of whole copies.
+	// Return nullptr to store a whole copy.
+	virtual std::unique_ptr<IUndoDelta<_TItem>> v_CreateUndoDelta(const _TItem &before, const _TItem &after) { return nullptr; }
+
+	// Roughly how much memory a whole copy of this resource takes.
+	virtual size_t v_GetUndoSize(const _TItem &item) { return UNDO_BUDGET / MAX_UNDO; }
+
 public:
 
 	typedef std::list<UndoData> _MyListType;
@@ -50,14 +86,17 @@ public:
 	CUndoResource()
 	{
 		_pos = _undo.end();
+		_nextId = 1;
+		_lastSavedId = 0;
 	}
 
 	void AddFirstResource(std::unique_ptr<_TItem> pResource, ptrdiff_t extra = 0)
 	{
 		ASSERT(_pos == _undo.end());
-		_pLastSaved = pResource.get();
-		_undo.emplace_back(std::move(pResource), extra);
+		_undo.emplace_back(std::move(pResource), extra, _nextId++);
 		_pos = _GetLastUndoFrame();
+		_MakeKeyframe(_pos);
+		_lastSavedId = _pos->id;
 	}
 
 	void AddNewResourceToUndo(std::unique_ptr<_TItem> pResourceNew, ptrdiff_t extra = 0)
@@ -74,10 +113,14 @@ public:
 			_undo.erase(posToDel);
 		}
 
+		// The current one won't change anymore, so we can work out its delta now.
+		_Settle(_pos);
+
 		// Insert after the current pos (which is now the end), and make this our new pos.
-		_undo.emplace_back(std::move(pResourceNew), extra);
+		_undo.emplace_back(std::move(pResourceNew), extra, _nextId++);
 		_pos = _GetLastUndoFrame();
 
+		_ReleaseItems();
 		// Make sure we don't grow infinitely.
 		_TrimUndoStack();
 	}
@@ -92,7 +135,20 @@ public:
 
 	void SetLastSaved(const _TItem *pResource)
 	{
-		_pLastSaved = pResource;
+		_lastSavedId = 0;
+		for (typename _MyListType::iterator pos = _undo.begin(); pos != _undo.end(); ++pos)
+		{
+			if (pos->item.get() == pResource)
+			{
+				_lastSavedId = pos->id;
+				// Saving can change the resource in place (e.g. its number), so its delta may no longer be right.
+				if (!pos->pending)
+				{
+					_MakeKeyframe(pos);
+				}
+				break;
+			}
+		}
 	}
 
 	// Gets the resource at the current location
@@ -119,8 +175,11 @@ protected:
 		if (_pos != _undo.begin())
 		{
 			--_pos;
+			_Materialize(_pos);
 			_OnUndoRedo();
-			SetModifiedFlag((*_pos).item.get() != _pLastSaved);
+			SetModifiedFlag((*_pos).id != _lastSavedId);
+			// Only after the views have moved onto the new item.
+			_ReleaseItems();
 		}
 	}
 
@@ -129,8 +188,10 @@ protected:
 		if (_pos != _GetLastUndoFrame())
 		{
 			++_pos;
+			_Materialize(_pos);
 			_OnUndoRedo();
-			SetModifiedFlag((*_pos).item.get() != _pLastSaved);
+			SetModifiedFlag((*_pos).id != _lastSavedId);
+			_ReleaseItems();
 		}
 	}
 
@@ -173,29 +234,109 @@ private:
 		v_OnUndoRedo();
 	}
 
-	void _TrimUndoStack()
+	void _MakeKeyframe(typename _MyListType::iterator pos)
+	{
+		_Materialize(pos);
+		pos->delta.reset();
+		pos->isKeyframe = true;
+		pos->pending = false;
+		pos->size = v_GetUndoSize(*pos->item);
+	}
+
+	// Works out the delta for a frame from the previous one, now that it's done changing.
+	void _Settle(typename _MyListType::iterator pos)
+	{
+		if (pos->pending)
+		{
+			bool keyframe = (pos == _undo.begin());
+			typename _MyListType::iterator prev = pos;
+			int distance = 0;
+			while (!keyframe && !prev->isKeyframe && (prev != _undo.begin()))
+			{
+				--prev;
+				distance++;
+			}
+			if (!keyframe && (distance < UNDO_KEYFRAME_INTERVAL))
+			{
+				prev = pos;
+				--prev;
+				_Materialize(prev);
+				pos->delta = v_CreateUndoDelta(*prev->item, *pos->item);
+			}
+			if (pos->delta)
+			{
+				pos->pending = false;
+				pos->size = pos->delta->GetSize();
+			}
+			else
+			{
+				_MakeKeyframe(pos);
+			}
+		}
+	}
+
+	// Rebuilds a frame's item from the nearest one before it that has one.
+	void _Materialize(typename _MyListType::iterator pos)
+	{
+		if (!pos->item)
+		{
+			typename _MyListType::iterator source = pos;
+			while (!source->item)
+			{
+				--source;
+			}
+			std::unique_ptr<_TItem> item = source->item->Clone();
+			while (source != pos)
+			{
+				++source;
+				source->delta->Apply(*item);
+			}
+			pos->item = std::move(item);
+		}
+	}
+
+	// Drops the copies we can rebuild from deltas, and won't need soon.
+	void _ReleaseItems()
 	{
-		if (_undo.size() > MAX_UNDO)
+		for (typename _MyListType::iterator pos = _undo.begin(); pos != _undo.end(); ++pos)
 		{
-			// Remove every other stored frame, up to a certain point.
-			_MyListType::iterator pos = _undo.begin();
-			BOOL fRemove = FALSE;
-			for (int i = 0; i < AGGRESSIVITY_UNDO; i++)
+			if (pos->item && !pos->isKeyframe && !pos->pending && (pos != _pos))
 			{
-				if (pos != _pos) // Skip it if it's where we currently are!
+				typename _MyListType::iterator next = pos;
+				++next;
+				if ((next == _undo.end()) || !next->pending)
 				{
-					_MyListType::iterator posToMaybeDelete = pos;
-					++pos;
-					if (fRemove)
-					{
-						_undo.erase(posToMaybeDelete);
-					}
-					fRemove = !fRemove;
+					pos->item.reset();
 				}
 			}
 		}
 	}
 
+	void _TrimUndoStack()
+	{
+		size_t total = 0;
+		for (const UndoData &data : _undo)
+		{
+			total += data.pending ? v_GetUndoSize(*data.item) : data.size;
+		}
+
+		// Remove the oldest frames until we fit (but never the one we're at).
+		while (((_undo.size() > MAX_UNDO) || (total > UNDO_BUDGET)) && (_undo.begin() != _pos))
+		{
+			typename _MyListType::iterator second = _undo.begin();
+			++second;
+			if (!second->isKeyframe)
+			{
+				// It needs to become the new start, so it needs a whole copy.
+				total -= second->pending ? v_GetUndoSize(*second->item) : second->size;
+				_MakeKeyframe(second);
+				total += second->size;
+			}
+			total -= _undo.front().size;
+			_undo.pop_front();
+		}
+	}
+
 	typename _MyListType::iterator _GetLastUndoFrame()
 	{
 		_MyListType::iterator pos = _undo.end();
@@ -206,7 +347,8 @@ private:
 	_MyListType _undo;
 	typename _MyListType::iterator _pos;
 
-	const _TItem *_pLastSaved; // Weak ref
+	uint32_t _nextId;
+	uint32_t _lastSavedId;		// The frame that matches what's on disk
 };
 
 BEGIN_TEMPLATE_MESSAGE_MAP_2(CUndoResource, _TBase, _TItem, _TBase)
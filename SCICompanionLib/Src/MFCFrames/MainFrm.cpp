@@ -1977,7 +1977,9 @@ void PurgeUnnecessaryResources()
 {
 	std::map<ResourceType, RebuildStats> stats;
 	const GameFolderHelper &helper = appState->GetResourceMap().Helper();
+	auto start = std::chrono::steady_clock::now();
 	HRESULT hr = RebuildResources(helper, helper.Version, TRUE, helper.GetResourceSaveLocation(ResourceSaveLocation::Default), stats);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 	if (SUCCEEDED(hr))
 	{
 		size_t totalSize = 0;
@@ -1987,14 +1989,16 @@ void PurgeUnnecessaryResources()
 		}
 		vector<CompileResult> statResults;
 		statResults.emplace_back(fmt::format("Total package size: {0:5}KB", totalSize / 1024), CompileResult::CompileResultType::CRT_Message);
+		statResults.emplace_back(fmt::format("Rebuilt in {0:.2f}s ({1:.1f}MB/s)", seconds, (seconds > 0.0) ? (totalSize / (1024.0 * 1024.0) / seconds) : 0.0), CompileResult::CompileResultType::CRT_Message);
 
 		for (const auto &stat : stats)
 		{
-			std::string result = fmt::format("{0:3} {1:>10}: Total size: {2:4}KB ({3:4.2f}% of total)",
+			std::string result = fmt::format("{0:3} {1:>10}: Total size: {2:4}KB ({3:4.2f}% of total) {4:6.1f}MB/s",
 				stat.second.ItemCount,
 				ResourceDisplayNameFromType(stat.first),
 				stat.second.TotalSize / 1024,
-				((float)stat.second.TotalSize / (float)totalSize) * 100.0f
+				((float)stat.second.TotalSize / (float)totalSize) * 100.0f,
+				(stat.second.Seconds > 0.0) ? (stat.second.TotalSize / (1024.0 * 1024.0) / stat.second.Seconds) : 0.0
 			);
 			statResults.emplace_back(result, CompileResult::CompileResultType::CRT_Message);
 		}
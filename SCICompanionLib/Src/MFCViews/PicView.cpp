@@ -1371,7 +1371,7 @@ void CPicView::EditCelData()
 				PicCommand &command = pic.commands[position];
 				if (command.type == PicCommand::CommandType::DrawBitmap)
 				{
-					EditCelDataDialog dialog(command.drawVisualBitmap.priority, *command.drawVisualBitmap.pCel);
+					EditCelDataDialog dialog(command.drawVisualBitmap.priority, command.GetWritableCel());
 					if (dialog.DoModal() == IDOK)
 					{
 						hint = PicChangeHint::EditPicInvalid;
@@ -2563,7 +2563,7 @@ void CPicView::_MovePriorityBar(bool commit, int dy)
 	newPriValue = max(minBound, min(maxBound, newPriValue));
 
 	PicCommand newPriBarsCommand = _originalPriValueCommand;
-	newPriBarsCommand.setPriorityBars.pPriorityLines[_priBarMoveIndex] = newPriValue;
+	newPriBarsCommand.GetWritablePriorityLines()[_priBarMoveIndex] = newPriValue;
 
 	// Find the pri bar command
 	// HACK: We're modifying the pic commands directly.
@@ -3461,7 +3461,7 @@ BOOL CPicView::OnEraseBkgnd(CDC *pDC)
 
 void CPicView::_OnHistoryLClick(CPoint point)
 {
-	size_t iPos = _GetDrawManager().PosFromPoint(point.x, point.y, -1);
+	size_t iPos = _GetDrawManager().PosFromPoint(point.x, point.y, -1, _mainViewScreen);
 
 	// We'll set the pos!
 	GetDocument()->SeekToPos(iPos);
@@ -3469,7 +3469,7 @@ void CPicView::_OnHistoryLClick(CPoint point)
 
 void CPicView::_OnHistoryRClick(CPoint point)
 {
-	size_t iPos = _GetDrawManager().PosFromPoint(point.x, point.y, -1);
+	size_t iPos = _GetDrawManager().PosFromPoint(point.x, point.y, -1, _mainViewScreen);
 	iPos++;
 
 	// We'll set the pos!
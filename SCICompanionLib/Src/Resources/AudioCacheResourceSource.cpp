@@ -25,6 +25,7 @@
 #include "PerfTimer.h"
 #include "ResourceBlob.h"
 #include "ResourceMap.h"
+#include "MappedFile.h"
 
 using namespace std::tr2;
 
@@ -673,7 +674,7 @@ std::ostream *_ChooseBakOutputStream(SCIVersion version, const std::string &game
 	return toUse;
 }
 
-void AudioCacheResourceSource::RebuildResources(bool force, ResourceSource &source, std::map<ResourceType, RebuildStats> &stats)
+void AudioCacheResourceSource::RebuildResources(bool force, ResourceSource &source, const RebuildOptions &options, std::map<ResourceType, RebuildStats> &stats)
 {
 	UpToDateResources upToDate(_cacheFolder);
 
@@ -774,6 +775,7 @@ void AudioCacheResourceSource::RebuildResources(bool force, ResourceSource &sour
 		{
 			audStream.close();
 			std::string finalPath = GetAudioVolumePath(_gameFolder, false, AudioVolumeName::Aud);
+			g_mappedFileCache.Invalidate(finalPath);
 			deletefile(finalPath);
 			movefile(GetAudioVolumePath(_gameFolder, true, AudioVolumeName::Aud), finalPath);
 		}
@@ -781,6 +783,7 @@ void AudioCacheResourceSource::RebuildResources(bool force, ResourceSource &sour
 		{
 			sfxStream.close();
 			std::string finalPath = GetAudioVolumePath(_gameFolder, false, AudioVolumeName::Sfx);
+			g_mappedFileCache.Invalidate(finalPath);
 			deletefile(finalPath);
 			movefile(GetAudioVolumePath(_gameFolder, true, AudioVolumeName::Sfx), finalPath);
 		}
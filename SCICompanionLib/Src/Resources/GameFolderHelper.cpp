@@ -22,6 +22,8 @@
 #include "AudioCacheResourceSource.h"
 #include "PatchResourceSource.h"
 #include "AppState.h"
+#include "ResourceIndex.h"
+#include "GameIniCache.h"
 
 using namespace std;
 
@@ -33,6 +35,7 @@ const std::string AspectRatioKey = "UseSierraAspectRatio";
 const std::string UnditherKey = "UnditherEGA";
 const std::string PatchFileKey = "SaveToPatchFiles";
 const std::string NoDbugStrKey = "NoDbugStr";
+const std::string CompressResourcesKey = "CompressResources";
 const std::string TrueValue = "true";
 const std::string FalseValue = "false";
 const std::string GenerateDebugInfoKey = "GenerateDebugInfo";
@@ -153,17 +156,7 @@ std::string GameFolderHelper::GetHelpFolder()
 //
 std::string GameFolderHelper::GetIniString(const std::string &sectionName, const std::string &keyName, PCSTR pszDefault) const
 {
-	std::string strRet;
-	char sz[200];
-	if (GetPrivateProfileString(sectionName.c_str(), keyName.c_str(), nullptr, sz, (DWORD)ARRAYSIZE(sz), GetGameIniFileName().c_str()))
-	{
-		strRet = sz;
-	}
-	else
-	{
-		strRet = pszDefault;
-	}
-	return strRet;
+	return g_gameIniCache.GetString(GetGameIniFileName(), sectionName, keyName, pszDefault);
 }
 
 bool GameFolderHelper::GetIniBool(const std::string &sectionName, const std::string &keyName, bool value) const
@@ -179,9 +172,18 @@ bool GameFolderHelper::DoesSectionExistWithEntries(const std::string &sectionNam
 void GameFolderHelper::SetIniString(const std::string &sectionName, const std::string &keyName, const std::string &value) const
 {
 	WritePrivateProfileString(sectionName.c_str(), keyName.c_str(), value.empty() ? nullptr : value.c_str(), GetGameIniFileName().c_str());
+	g_gameIniCache.Invalidate(GetGameIniFileName());
 }
 
 
+void GameFolderHelper::ReleaseResourceIndex() const
+{
+	if (_resourceIndex)
+	{
+		_resourceIndex->Invalidate();
+	}
+}
+
 std::string GameFolderHelper::GetGameIniFileName() const
 {
 	string filename = this->GameFolder;
@@ -274,6 +276,17 @@ void GameFolderHelper::SetNoDbugStr(bool noDbug) const
 	SetIniString(GameSection, NoDbugStrKey, noDbug ? TrueValue : FalseValue);
 }
 
+bool GameFolderHelper::GetCompressResources() const
+{
+	std::string value = GetIniString(GameSection, CompressResourcesKey, FalseValue.c_str());
+	std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+	return value == TrueValue;
+}
+void GameFolderHelper::SetCompressResources(bool compress) const
+{
+	SetIniString(GameSection, CompressResourcesKey, compress ? TrueValue : FalseValue);
+}
+
 bool GameFolderHelper::GetGenerateDebugInfo() const
 {
 	std::string value = GetIniString(GameSection, GenerateDebugInfoKey, FalseValue.c_str());
@@ -336,6 +349,20 @@ std::unique_ptr<ResourceContainer> GameFolderHelper::Resources(ResourceTypeFlags
 		ClearFlag(types, ResourceTypeFlags::AudioMap);
 	}
 
+	std::unique_ptr<ResourceContainer> resourceContainer(
+		new ResourceContainer(
+		GameFolder,
+		CreateResourceSources(types, enumFlags, mapContext),
+		types,
+		enumFlags,
+		pRecency)
+		);
+
+	return resourceContainer;
+}
+
+std::unique_ptr<ResourceSourceArray> GameFolderHelper::CreateResourceSources(ResourceTypeFlags types, ResourceEnumFlags enumFlags, int mapContext) const
+{
 	// Resources can come from various sources.
 	std::unique_ptr<ResourceSourceArray> mapAndVolumes = std::make_unique<ResourceSourceArray>();
 
@@ -394,22 +421,18 @@ std::unique_ptr<ResourceContainer> GameFolderHelper::Resources(ResourceTypeFlags
 		}
 	}
 
-	std::unique_ptr<ResourceContainer> resourceContainer(
-		new ResourceContainer(
-		GameFolder,
-		move(mapAndVolumes),
-		types,
-		enumFlags,
-		pRecency)
-		);
-
-	return resourceContainer;
+	return mapAndVolumes;
 }
 
 std::unique_ptr<ResourceBlob> GameFolderHelper::MostRecentResource(ResourceType type, int number, ResourceEnumFlags flags, uint32_t base36Number, int mapContext) const
 {
 	std::unique_ptr<ResourceBlob> returnBlob;
 	ResourceEnumFlags enumFlags = flags | ResourceEnumFlags::MostRecentOnly;
+	if (_resourceIndex && _resourceIndex->TryMostRecentResource(*this, type, number, enumFlags, base36Number, mapContext, returnBlob))
+	{
+		return returnBlob;
+	}
+
 	auto &resourceContainer = Resources(ResourceTypeToFlag(type), enumFlags, nullptr, mapContext);
 	for (auto &blobIt = resourceContainer->begin(); blobIt != resourceContainer->end(); ++blobIt)
 	{
@@ -432,6 +455,13 @@ bool GameFolderHelper::DoesResourceExist(ResourceType type, int number, std::str
 	{
 		enumFlags |= ResourceEnumFlags::NameLookups;
 	}
+
+	bool exists;
+	if (_resourceIndex && _resourceIndex->TryDoesResourceExist(*this, type, number, enumFlags, retrieveName, exists))
+	{
+		return exists;
+	}
+
 	auto &resourceContainer = Resources(ResourceTypeToFlag(type), enumFlags);
 	for (auto &blobIt = resourceContainer->begin(); blobIt != resourceContainer->end(); ++blobIt)
 	{
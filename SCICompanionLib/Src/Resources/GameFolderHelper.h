@@ -24,6 +24,9 @@ enum class ResourceSourceFlags : int;
 
 class ResourceRecency;
 class ResourceBlob;
+class ResourceSource;
+class ResourceIndex;
+typedef std::vector<std::unique_ptr<ResourceSource>> ResourceSourceArray;
 
 extern const std::string GameSection;
 extern const std::string LanguageKey;
@@ -67,6 +70,7 @@ public:
 	ScriptId GetScriptId(const std::string &name) const;
 	std::string FigureOutName(ResourceType type, int iResourceNum, uint32_t base36Number) const;
 	std::unique_ptr<ResourceContainer> Resources(ResourceTypeFlags types, ResourceEnumFlags enumFlags, ResourceRecency *pRecency = nullptr, int mapContext = -1) const;
+	std::unique_ptr<ResourceSourceArray> CreateResourceSources(ResourceTypeFlags types, ResourceEnumFlags enumFlags, int mapContext) const;
 	std::unique_ptr<ResourceBlob> GameFolderHelper::MostRecentResource(ResourceType type, int number, ResourceEnumFlags flags, uint32_t base36Number = NoBase36, int mapContext = -1) const;
 	bool DoesResourceExist(ResourceType type, int number, std::string *retrieveName, ResourceSaveLocation location) const;
 
@@ -76,6 +80,9 @@ public:
 	void SetUndither(bool undither) const;
 	bool GetNoDbugStr() const;
 	void SetNoDbugStr(bool dbugStr) const;
+	// Whether rebuilding the resource package compresses the resources.
+	bool GetCompressResources() const;
+	void SetCompressResources(bool compress) const;
 
 	bool GetGenerateDebugInfo() const;
 
@@ -86,6 +93,11 @@ public:
 
 	bool IsResourceCompatible(const ResourceBlob &resource) const;
 
+	// Optional. Copies of this helper share the same index.
+	void SetResourceIndex(std::shared_ptr<ResourceIndex> resourceIndex) { _resourceIndex = resourceIndex; }
+	// The index holds views of the resource volumes. This lets go of them, so that the volumes can be replaced.
+	void ReleaseResourceIndex() const;
+
 	// Members
 	SCIVersion Version;
 	std::string GameFolder;
@@ -93,4 +105,6 @@ public:
 
 private:
 	std::string _GetSubfolder(const char *key, const std::string *prefix = nullptr) const;
+
+	std::shared_ptr<ResourceIndex> _resourceIndex;
 };
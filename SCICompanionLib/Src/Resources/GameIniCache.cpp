@@ -0,0 +1,203 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#include "stdafx.h"
+#include "GameIniCache.h"
+
+using namespace std;
+
+GameIniCache g_gameIniCache;
+
+namespace
+{
+	void _Trim(const char *&begin, const char *&end)
+	{
+		while ((begin < end) && isspace((uint8_t)*begin))
+		{
+			begin++;
+		}
+		while ((end > begin) && isspace((uint8_t)*(end - 1)))
+		{
+			end--;
+		}
+	}
+
+	void _AppendLower(string &str, const char *begin, const char *end)
+	{
+		while (begin < end)
+		{
+			str.push_back((char)tolower((uint8_t)*begin));
+			begin++;
+		}
+	}
+
+	string _ToLower(const string &str)
+	{
+		string lower;
+		lower.reserve(str.size());
+		_AppendLower(lower, str.data(), str.data() + str.size());
+		return lower;
+	}
+}
+
+string GameIniTable::_MakeKey(const string &sectionName, const string &keyName)
+{
+	string key;
+	key.reserve(sectionName.size() + keyName.size() + 1);
+	_AppendLower(key, sectionName.data(), sectionName.data() + sectionName.size());
+	key.push_back('\n');
+	_AppendLower(key, keyName.data(), keyName.data() + keyName.size());
+	return key;
+}
+
+unique_ptr<GameIniTable> GameIniTable::Parse(const char *data, size_t length)
+{
+	unique_ptr<GameIniTable> table = make_unique<GameIniTable>();
+	const char *end = data + length;
+	const char *lineStart = data;
+	string section;
+	bool inSection = false;
+	while (lineStart < end)
+	{
+		const char *lineEnd = lineStart;
+		while ((lineEnd < end) && (*lineEnd != '\n') && (*lineEnd != '\r'))
+		{
+			lineEnd++;
+		}
+		const char *next = lineEnd;
+		while ((next < end) && ((*next == '\n') || (*next == '\r')))
+		{
+			next++;
+		}
+
+		const char *begin = lineStart;
+		_Trim(begin, lineEnd);
+		if ((begin < lineEnd) && (*begin == '['))
+		{
+			const char *close = find(begin + 1, lineEnd, ']');
+			const char *nameBegin = begin + 1;
+			const char *nameEnd = close;
+			_Trim(nameBegin, nameEnd);
+			section.clear();
+			_AppendLower(section, nameBegin, nameEnd);
+			inSection = true;
+		}
+		else if (inSection && (begin < lineEnd) && (*begin != ';'))
+		{
+			const char *equals = find(begin, lineEnd, '=');
+			if (equals != lineEnd)
+			{
+				const char *keyBegin = begin;
+				const char *keyEnd = equals;
+				_Trim(keyBegin, keyEnd);
+				const char *valueBegin = equals + 1;
+				const char *valueEnd = lineEnd;
+				_Trim(valueBegin, valueEnd);
+				// The profile API strips one set of matching quotes.
+				if (((valueEnd - valueBegin) >= 2) && ((*valueBegin == '"') || (*valueBegin == '\'')) && (*(valueEnd - 1) == *valueBegin))
+				{
+					valueBegin++;
+					valueEnd--;
+				}
+
+				string key = section;
+				key.push_back('\n');
+				_AppendLower(key, keyBegin, keyEnd);
+				// emplace won't replace an existing key, so the first one wins.
+				table->_values.emplace(move(key), string(valueBegin, valueEnd));
+			}
+		}
+		lineStart = next;
+	}
+	return table;
+}
+
+const string *GameIniTable::Find(const string &sectionName, const string &keyName) const
+{
+	auto it = _values.find(_MakeKey(sectionName, keyName));
+	if ((it != _values.end()) && !it->second.empty())
+	{
+		return &it->second;
+	}
+	return nullptr;
+}
+
+string GameIniTable::GetString(const string &sectionName, const string &keyName, PCSTR pszDefault) const
+{
+	const string *value = Find(sectionName, keyName);
+	return value ? *value : string(pszDefault);
+}
+
+shared_ptr<const GameIniTable> GameIniCache::GetTable(const string &iniFileName)
+{
+	uint64_t lastWriteTime = 0;
+	uint64_t size = 0;
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	bool exists = !!GetFileAttributesEx(iniFileName.c_str(), GetFileExInfoStandard, &attributes);
+	if (exists)
+	{
+		lastWriteTime = ((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+		size = ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+	}
+
+	string cacheKey = _ToLower(iniFileName);
+	{
+		lock_guard<mutex> lock(_mutex);
+		auto it = _tables.find(cacheKey);
+		if ((it != _tables.end()) && (it->second.LastWriteTime == lastWriteTime) && (it->second.Size == size))
+		{
+			return it->second.Table;
+		}
+	}
+
+	// Parse outside the lock. If two threads race here, they'll produce the same thing.
+	shared_ptr<const GameIniTable> table;
+	if (exists)
+	{
+		try
+		{
+			ScopedFile file(iniFileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, OPEN_EXISTING);
+			uint32_t length = file.GetLength();
+			unique_ptr<char[]> data = make_unique<char[]>(max<uint32_t>(length, 1));
+			length = file.ReadAt(0, reinterpret_cast<uint8_t*>(data.get()), length);
+			table = GameIniTable::Parse(data.get(), length);
+		}
+		catch (std::exception)
+		{
+			// Treat it as empty, but don't cache it so we try again next time.
+			return GameIniTable::Parse(nullptr, 0);
+		}
+	}
+	else
+	{
+		table = GameIniTable::Parse(nullptr, 0);
+	}
+
+	lock_guard<mutex> lock(_mutex);
+	CachedTable &cached = _tables[cacheKey];
+	cached.LastWriteTime = lastWriteTime;
+	cached.Size = size;
+	cached.Table = table;
+	return table;
+}
+
+string GameIniCache::GetString(const string &iniFileName, const string &sectionName, const string &keyName, PCSTR pszDefault)
+{
+	return GetTable(iniFileName)->GetString(sectionName, keyName, pszDefault);
+}
+
+void GameIniCache::Invalidate(const string &iniFileName)
+{
+	lock_guard<mutex> lock(_mutex);
+	_tables.erase(_ToLower(iniFileName));
+}
@@ -0,0 +1,67 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#pragma once
+
+//
+// The contents of an ini file, parsed into memory. Section and key names are case-insensitive,
+// and the first occurrence of a key wins, as with GetPrivateProfileString.
+//
+class GameIniTable
+{
+public:
+	static std::unique_ptr<GameIniTable> Parse(const char *data, size_t length);
+
+	// Returns nullptr if the key doesn't exist (or has an empty value).
+	const std::string *Find(const std::string &sectionName, const std::string &keyName) const;
+	std::string GetString(const std::string &sectionName, const std::string &keyName, PCSTR pszDefault = "") const;
+
+private:
+	static std::string _MakeKey(const std::string &sectionName, const std::string &keyName);
+
+	std::unordered_map<std::string, std::string> _values;
+};
+
+//
+// Parsed ini files, keyed by filename, so that looking up resource names doesn't re-read game.ini
+// through the profile API each time.
+// A table is re-parsed if the file's size or last write time has changed since it was loaded. Code that
+// writes to an ini file should also call Invalidate, since timestamps don't always have enough resolution.
+// Tables are immutable once loaded, so callers can hold on to one for a batch of lookups.
+//
+class GameIniCache
+{
+public:
+	GameIniCache() = default;
+	GameIniCache(const GameIniCache &src) = delete;
+	GameIniCache &operator=(const GameIniCache &src) = delete;
+
+	// Never returns nullptr. A missing file results in an empty table.
+	std::shared_ptr<const GameIniTable> GetTable(const std::string &iniFileName);
+	std::string GetString(const std::string &iniFileName, const std::string &sectionName, const std::string &keyName, PCSTR pszDefault = "");
+
+	void Invalidate(const std::string &iniFileName);
+
+private:
+	struct CachedTable
+	{
+		uint64_t LastWriteTime;
+		uint64_t Size;
+		std::shared_ptr<const GameIniTable> Table;
+	};
+
+	std::mutex _mutex;
+	std::unordered_map<std::string, CachedTable> _tables;
+};
+
+extern GameIniCache g_gameIniCache;
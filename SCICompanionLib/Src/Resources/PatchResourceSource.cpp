@@ -83,6 +83,7 @@ bool PatchFilesResourceSource::ReadNextEntry(ResourceTypeFlags typeFlags, Iterat
 							entry.PackageNumber = 0;
 
 							// This is hokey, but we need a way to know the filename for an item
+							std::lock_guard<std::mutex> lock(_mutex);
 							_indexToFilename[_nextIndex] = _findData.cFileName;
 							_nextIndex++;
 							foundOne = true;
@@ -104,38 +105,63 @@ bool PatchFilesResourceSource::ReadNextEntry(ResourceTypeFlags typeFlags, Iterat
 	return _stillMore || foundOne;
 }
 
-sci::istream PatchFilesResourceSource::GetHeaderAndPositionedStream(const ResourceMapEntryAgnostic &mapEntry, ResourceHeaderAgnostic &headerEntry)
+std::string PatchFilesResourceSource::_GetFullPath(const ResourceMapEntryAgnostic &mapEntry)
 {
-	std::string fileName = _indexToFilename[mapEntry.ExtraData];	// We used package number as a transport vessel for our arbitrary data
+	std::string fileName;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		fileName = _indexToFilename[mapEntry.ExtraData];	// We used package number as a transport vessel for our arbitrary data
+	}
 	assert(!fileName.empty());
+	return _gameFolder + "\\" + fileName;
+}
+
+void PatchFilesResourceSource::_FillHeader(const ResourceMapEntryAgnostic &mapEntry, uint32_t fileSize, ResourceHeaderAgnostic &headerEntry)
+{
+	headerEntry.Number = mapEntry.Number;
+	headerEntry.Base36Number = mapEntry.Base36Number;
+	headerEntry.Type = mapEntry.Type;
+	headerEntry.CompressionMethod = 0;
+	headerEntry.Version = _version;
+
+	uint32_t size = (fileSize > mapEntry.Offset) ? (fileSize - mapEntry.Offset) : 0;
+	headerEntry.cbDecompressed = size;
+	headerEntry.cbCompressed = size;
+	headerEntry.SourceFlags = _sourceFlags;
+	headerEntry.PackageHint = 0;	// No package.
+}
+
+sci::istream PatchFilesResourceSource::GetHeaderAndPositionedStream(const ResourceMapEntryAgnostic &mapEntry, ResourceHeaderAgnostic &headerEntry)
+{
 	ScopedHandle patchFile;
-	std::string fullPath = _gameFolder + "\\" + fileName;
+	std::string fullPath = _GetFullPath(mapEntry);
 	patchFile.hFile = CreateFile(fullPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
 	if (patchFile.hFile != INVALID_HANDLE_VALUE)
 	{
 		auto streamHolder = std::make_unique<sci::streamOwner>(patchFile.hFile);
 		sci::istream readStream = streamHolder->getReader();
 		// We need to be owners of this stream data.
-		_streamHolder[mapEntry.ExtraData] = move(streamHolder);
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_streamHolder[mapEntry.ExtraData] = move(streamHolder);
+		}
 
 		// Now fill in the headerEntry
-		headerEntry.Number = mapEntry.Number;
-		headerEntry.Base36Number = mapEntry.Base36Number;
-		headerEntry.Type = mapEntry.Type;
-		headerEntry.CompressionMethod = 0;
-		headerEntry.Version = _version;
+		_FillHeader(mapEntry, readStream.GetDataSize(), headerEntry);
 
 		readStream.seekg(mapEntry.Offset);
-		headerEntry.cbDecompressed = readStream.getBytesRemaining();
-		headerEntry.cbCompressed = readStream.getBytesRemaining();
-		headerEntry.SourceFlags = _sourceFlags;
-		headerEntry.PackageHint = 0;	// No package.
-
 		return readStream;
 	}
 	return sci::istream(nullptr, 0); // Empty stream....
 }
 
+void PatchFilesResourceSource::ReadHeader(const ResourceMapEntryAgnostic &mapEntry, ResourceHeaderAgnostic &headerEntry)
+{
+	// There's no header in the file, other than the type and offset which we've already read. So all we need is the size.
+	ScopedFile patchFile(_GetFullPath(mapEntry), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING);
+	_FillHeader(mapEntry, patchFile.GetLength(), headerEntry);
+}
+
 sci::istream PatchFilesResourceSource::GetPositionedStreamAndResourceSizeIncludingHeader(const ResourceMapEntryAgnostic &mapEntry, uint32_t &size, bool &includesHeader)
 {
 	includesHeader = false;
@@ -27,12 +27,16 @@ public:
 	bool ReadNextEntry(ResourceTypeFlags typeFlags, IteratorState &state, ResourceMapEntryAgnostic &entry, std::vector<uint8_t> *optionalRawData = nullptr) override;
 	sci::istream GetHeaderAndPositionedStream(const ResourceMapEntryAgnostic &mapEntry, ResourceHeaderAgnostic &headerEntry) override;
 	sci::istream GetPositionedStreamAndResourceSizeIncludingHeader(const ResourceMapEntryAgnostic &mapEntry, uint32_t &size, bool &includesHeader) override;
+	void ReadHeader(const ResourceMapEntryAgnostic &mapEntry, ResourceHeaderAgnostic &headerEntry) override;
 
 	void RemoveEntry(const ResourceMapEntryAgnostic &mapEntry) override;
 	AppendBehavior AppendResources(const std::vector<const ResourceBlob*> &blobs) override;
-	void RebuildResources(bool force, ResourceSource &source, std::map<ResourceType, RebuildStats> &stats) override {} // Nothing to do here.
+	void RebuildResources(bool force, ResourceSource &source, const RebuildOptions &options, std::map<ResourceType, RebuildStats> &stats) override {} // Nothing to do here.
 
 private:
+	std::string _GetFullPath(const ResourceMapEntryAgnostic &mapEntry);
+	void _FillHeader(const ResourceMapEntryAgnostic &mapEntry, uint32_t fileSize, ResourceHeaderAgnostic &headerEntry);
+
 	HANDLE _hFind;
 	bool _stillMore;
 	std::string _gameFolder;
@@ -43,6 +47,8 @@ private:
 	ResourceSourceFlags _sourceFlags;
 
 	// Muck
+	// Guards _indexToFilename and _streamHolder, since resources may be read on multiple threads while rebuilding.
+	std::mutex _mutex;
 	int _nextIndex;
 	std::unordered_map<int, std::string> _indexToFilename;
 	std::unordered_map<int, std::unique_ptr<sci::streamOwner>> _streamHolder;
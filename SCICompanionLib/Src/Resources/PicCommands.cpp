@@ -19,6 +19,7 @@
 #include "RasterOperations.h"
 #include "View.h"
 #include <limits>
+#include <atomic>
 #include "PicCommands.h"
 
 #ifdef _DEBUG
@@ -727,14 +728,27 @@ inline void _PlotPix(PicData *pData, int16_t x, int16_t y, PicScreenFlags dwDraw
 	// Duplicate the code from _PlotPixI here for speed (perf increase of ~5%?)
 	if (IsFlagSet(pData->dwMapsToRedraw, PicScreenFlags::Visual) && IsFlagSet(dwDrawEnable, PicScreenFlags::Visual))
 	{
-		pData->pdataVisual[p] = _TFormat::Plot(x, y, color);
+		uint8_t value = _TFormat::Plot(x, y, color);
+		if (pData->pdataWriters[0] && (pData->pdataVisual[p] != value))
+		{
+			pData->pdataWriters[0][p] = pData->currentCommand;
+		}
+		pData->pdataVisual[p] = value;
 	}
 	if (IsFlagSet(pData->dwMapsToRedraw, PicScreenFlags::Priority) && IsFlagSet(dwDrawEnable, PicScreenFlags::Priority))
 	{
+		if (pData->pdataWriters[1] && (pData->pdataPriority[p] != bPriorityValue))
+		{
+			pData->pdataWriters[1][p] = pData->currentCommand;
+		}
 		pData->pdataPriority[p] = bPriorityValue;
 	}
 	if (IsFlagSet(pData->dwMapsToRedraw, PicScreenFlags::Control) && IsFlagSet(dwDrawEnable, PicScreenFlags::Control))
 	{
+		if (pData->pdataWriters[2] && (pData->pdataControl[p] != bControlValue))
+		{
+			pData->pdataWriters[2][p] = pData->currentCommand;
+		}
 		pData->pdataControl[p] = bControlValue;
 	}
 
@@ -1291,7 +1305,7 @@ bool HitTestEgoBox(int16_t xCursor, int16_t yCursor, int16_t xEgo, int16_t yEgo,
 	return TRUE;
 }
 
-void DrawImageWithPriority(size16 displaySize, uint8_t *pdataDisplay, const uint8_t *pdataPriority, uint8_t *pdataPriorityWrite, uint8_t bEgoPriority, int xLeft, int yTop, uint16_t cx, uint16_t cy, uint16_t cxStride, const uint8_t *pImageData, uint8_t transparent, bool fShowOutline, bool isEGAUndithered)
+void DrawImageWithPriority(size16 displaySize, uint8_t *pdataDisplay, const uint8_t *pdataPriority, uint8_t *pdataPriorityWrite, uint8_t bEgoPriority, int xLeft, int yTop, uint16_t cx, uint16_t cy, uint16_t cxStride, const uint8_t *pImageData, uint8_t transparent, bool fShowOutline, bool isEGAUndithered, CompositeKernel kernel)
 {
 	int xRight = xLeft + cx;
 	int yBottom = yTop + cy;
@@ -1311,61 +1325,40 @@ void DrawImageWithPriority(size16 displaySize, uint8_t *pdataDisplay, const uint
 			{
 				xViewRight -= (xRight - displaySize.cx);
 			}
+			if (xViewRight <= xViewLeft)
+			{
+				continue;
+			}
 
+			// The rows are contiguous in both buffers, so composite a whole row at once.
+			int xPicLeft = max(0, xLeft);
+			int pPicOffset = BUFFEROFFSET_NONSTD(displaySize.cx, displaySize.cy, xPicLeft, yPic);
+			int pViewOffset = BUFFEROFFSET_NONSTD(cxStride, cy, xViewLeft, yView);
 			int xFirstPixel = -1;
 			int xLastPixel = -1;
-			int xPic = max(0, xLeft);
-			for (int xView = xViewLeft; xView < xViewRight; xView++, xPic++)
-			{
-				int pPicOffset = BUFFEROFFSET_NONSTD(displaySize.cx, displaySize.cy, xPic, yPic);
-				// We can draw something.
-				int pViewOffset = BUFFEROFFSET_NONSTD(cxStride, cy, xView, yView);
-				uint8_t bView = *(pImageData + pViewOffset);
-				if (bView != transparent)
-				{
-					bool fShowing = (pdataPriority != nullptr) ? ((*(pdataPriority + pPicOffset)) <= bEgoPriority) : true;
-					if (fShowing)
-					{
-						// Copy a pixel!
-						if (isEGAUndithered)
-						{
-							// Duplicate the color into the other slot if undithered.
-							bView |= (bView << 4);
-						}
-						*(pdataDisplay + pPicOffset) = bView;
-						xLastPixel = -1;
+			CompositeRowWithPriority(kernel,
+				pdataDisplay + pPicOffset,
+				pdataPriority ? (pdataPriority + pPicOffset) : nullptr,
+				pdataPriorityWrite ? (pdataPriorityWrite + pPicOffset) : nullptr,
+				pImageData + pViewOffset,
+				xViewRight - xViewLeft,
+				bEgoPriority,
+				transparent,
+				isEGAUndithered,
+				fShowOutline ? &xFirstPixel : nullptr,
+				fShowOutline ? &xLastPixel : nullptr);
 
-						if (pdataPriorityWrite)
-						{
-							*(pdataPriorityWrite + pPicOffset) = bEgoPriority;
-						}
-					}
-					else
-					{
-						if (fShowOutline)
-						{
-							xLastPixel = xPic;
-							if (xFirstPixel == -1)
-							{
-								xFirstPixel = xPic;
-							}
-						}
-					}
-				}
-			}
 			if (fShowOutline)
 			{
-				if ((xFirstPixel >= 0) && (xFirstPixel < displaySize.cx))
+				// Mark where the view disappears behind things.
+				if (xFirstPixel >= 0)
 				{
-					int pPicOffset = BUFFEROFFSET_NONSTD(displaySize.cx, displaySize.cy, xFirstPixel, yPic);
-					*(pdataDisplay + pPicOffset) = bEgoPriority;
+					*(pdataDisplay + pPicOffset + xFirstPixel) = bEgoPriority;
 				}
-				if ((xLastPixel >= 0) && (xLastPixel < displaySize.cx))
+				if (xLastPixel >= 0)
 				{
-					int pPicOffset = BUFFEROFFSET_NONSTD(displaySize.cx, displaySize.cy, xLastPixel, yPic);
-					*(pdataDisplay + pPicOffset) = bEgoPriority;
+					*(pdataDisplay + pPicOffset + xLastPixel) = bEgoPriority;
 				}
-
 			}
 		}
 	}
@@ -1468,14 +1461,6 @@ void DrawBoxWithPriority(size16 picSize, uint8_t *pdataDisplay, const uint8_t *p
 	}
 }
 
-#define EMPTY ((__int32)-1)
-
-// Big global buffer.
-// We need to take care to serialize access to this.
-// It shouldn't be a problem if all drawing is done sequentially, and on the foreground thread.
-sPOINT g_buf[BMPSIZE_MAX + 1];
-sPOINT g_pEmpty={EMPTY,EMPTY};
-
 #define GET_PIX_VISUAL(cx, cy, x, y) (*((pdata->pdataVisual) + BUFFEROFFSET_NONSTD(cx, cy, x, y)))
 #define GET_PIX_AUX(cx, cy, x, y) (*((pdata->pdataAux) +  BUFFEROFFSET_NONSTD(cx, cy, x, y)))
 
@@ -1491,41 +1476,129 @@ sPOINT g_pEmpty={EMPTY,EMPTY};
 #define FILL_BOUNDS(cx, cy, fx, fy, TFormat) ((((uint8_t)dwDrawEnable) & GET_PIX_AUX((cx), (cy), (fx), (fy))) && \
 				  !(IsFlagSet(dwDrawEnable, PicScreenFlags::Visual) && (TFormat::IsPixelWhite(GET_PIX_VISUAL((cx), (cy), (fx), (fy)), fx, fy))))
 
+#define OK_TO_FILL(cx, cy, x,y,TFormat) ( CHECK_RECT((cx), (cy), (x),(y)) && !FILL_BOUNDS((cx), (cy), (x),(y),TFormat) )
 
-inline bool qstore(int displayByteSize, __int16 x,__int16 y, __int32 *prpos)
-{
-   if ((*prpos) == displayByteSize)
-   {
-	   return FALSE;
-   }
-   g_buf[*prpos].x = x;
-   g_buf[*prpos].y = y;
-   (*prpos)++;
-   return TRUE;
-}
+// Scratch space for fills. Each thread has its own, so pics can be drawn on several threads at once.
+thread_local std::vector<sPOINT> g_fillStack;
 
-inline sPOINT qretrieve(__int32 *prpos)
+//
+// The original fill: a 4-neighbour stack fill, one pixel at a time. The stack is limited to one entry per pixel,
+// and the fill stops when it runs out.
+//
+// This is only used when filled pixels can still look empty (see the BUG above), since then the same pixels get
+// pushed over and over, and where the fill ends up depends on when the stack runs out.
+//
+template<typename _TFormat>
+void _StackFill(PicData *pdata, int16_t x, int16_t y, typename  _TFormat::PixelType color, uint8_t bPriorityValue, uint8_t bControlValue, PicScreenFlags dwDrawEnable)
 {
-   if (!*prpos)
-   {
-	   return g_pEmpty;
-   }
-
-   (*prpos)--;
-   return g_buf[*prpos];
-}
+	int cx = pdata->size.cx;
+	int cy = pdata->size.cy;
+	int xMax = cx - 1;
+	int yMax = cy - 1;
+	size_t displayByteSize = cx * cy;
+	PicScreenFlags auxSet = dwDrawEnable;
 
+	std::vector<sPOINT> &stack = g_fillStack;
+	stack.clear();
+	stack.reserve(displayByteSize);
+	stack.push_back({ x, y });
+	while (!stack.empty())
+	{
+		sPOINT p = stack.back();
+		stack.pop_back();
+		int16_t x1 = p.x;
+		int16_t y1 = p.y;
+		if (OK_TO_FILL(cx, cy, x1, y1, _TFormat))
+		{
+			_PlotPix<_TFormat, PlotPixTool::Fill>(pdata, x1, y1, dwDrawEnable, auxSet, color, bPriorityValue, bControlValue);
 
-#define OK_TO_FILL(cx, cy, x,y,TFormat) ( CHECK_RECT((cx), (cy), (x),(y)) && !FILL_BOUNDS((cx), (cy), (x),(y),TFormat) )
+			// The order matters here, since it determines where we end up if we run out of room.
+			sPOINT neighbours[4] =
+			{
+				{ x1, (int16_t)(y1 - 1) },
+				{ (int16_t)(x1 - 1), y1 },
+				{ (int16_t)(x1 + 1), y1 },
+				{ x1, (int16_t)(y1 + 1) },
+			};
+			bool inBounds[4] = { (y1 != 0), (x1 != 0), (x1 != xMax), (y1 != yMax) };
+			for (int i = 0; i < 4; i++)
+			{
+				if (inBounds[i] && OK_TO_FILL(cx, cy, neighbours[i].x, neighbours[i].y, _TFormat))
+				{
+					if (stack.size() == displayByteSize)
+					{
+						return;
+					}
+					stack.push_back(neighbours[i]);
+				}
+			}
+		}
+	}
+}
 
-int g_commands = 0;
+//
+// Scanline fill: fills each horizontal run of empty pixels in one go, and only remembers where the runs
+// above and below start. This fills exactly the same pixels as _StackFill, as long as filled pixels don't
+// look empty anymore.
+//
+template<typename _TFormat>
+void _ScanlineFill(PicData *pdata, int16_t x, int16_t y, typename  _TFormat::PixelType color, uint8_t bPriorityValue, uint8_t bControlValue, PicScreenFlags dwDrawEnable)
+{
+	int cx = pdata->size.cx;
+	int cy = pdata->size.cy;
+	int xMax = cx - 1;
+	int yMax = cy - 1;
+	PicScreenFlags auxSet = dwDrawEnable;
 
+	std::vector<sPOINT> &stack = g_fillStack;
+	stack.clear();
+	stack.push_back({ x, y });
+	while (!stack.empty())
+	{
+		sPOINT p = stack.back();
+		stack.pop_back();
+		int16_t y1 = p.y;
+		// This may have been filled since it was pushed.
+		if (FILL_BOUNDS(cx, cy, p.x, y1, _TFormat))
+		{
+			continue;
+		}
 
-#define MOVING_RIGHT 0x00000001
-#define MOVING_LEFT  0x00000002
+		int16_t xLeft = p.x;
+		while ((xLeft > 0) && !FILL_BOUNDS(cx, cy, xLeft - 1, y1, _TFormat))
+		{
+			xLeft--;
+		}
+		int16_t xRight = p.x;
+		while ((xRight < xMax) && !FILL_BOUNDS(cx, cy, xRight + 1, y1, _TFormat))
+		{
+			xRight++;
+		}
 
+		for (int16_t x1 = xLeft; x1 <= xRight; x1++)
+		{
+			_PlotPix<_TFormat, PlotPixTool::Fill>(pdata, x1, y1, dwDrawEnable, auxSet, color, bPriorityValue, bControlValue);
+		}
 
-std::mutex g_mutexDither;
+		// Queue up the start of each run of empty pixels above and below.
+		for (int16_t yNext : { (int16_t)(y1 - 1), (int16_t)(y1 + 1) })
+		{
+			if ((yNext >= 0) && (yNext <= yMax))
+			{
+				bool inRun = false;
+				for (int16_t x1 = xLeft; x1 <= xRight; x1++)
+				{
+					bool empty = !FILL_BOUNDS(cx, cy, x1, yNext, _TFormat);
+					if (empty && !inRun)
+					{
+						stack.push_back({ x1, yNext });
+					}
+					inRun = empty;
+				}
+			}
+		}
+	}
+}
 
 template<typename _TFormat>
 void _DitherFill(PicData *pdata, int16_t x, int16_t y, typename  _TFormat::PixelType color, uint8_t bPriorityValue, uint8_t bControlValue, PicScreenFlags dwDrawEnable)
@@ -1546,20 +1619,8 @@ void _DitherFill(PicData *pdata, int16_t x, int16_t y, typename  _TFormat::Pixel
 		return;
 	}
 
-	// Guard access to the buffers we use for dithering.
-	std::lock_guard<std::mutex> lock(g_mutexDither);
-
-	g_commands =0;
-
-	sPOINT p;
-	__int32 rpos, spos;
-
 	int cx = pdata->size.cx;
 	int cy = pdata->size.cy;
-	int xMax = cx - 1;
-	int yMax = cy - 1;
-	int displayByteSize = cx * cy;
-
 	if (!CHECK_RECT(cx, cy, x, y))
 	{
 		return;
@@ -1570,54 +1631,27 @@ void _DitherFill(PicData *pdata, int16_t x, int16_t y, typename  _TFormat::Pixel
 		return;
 	}
 
-	__int16 x1, y1;
-
-	rpos = spos = 0;
-
-	if (!qstore(displayByteSize, x, y, &rpos))
+	// Will the pixels we fill still look empty afterwards? That's the case if some of them are white (or if
+	// the visual screen isn't being drawn, so they stay whatever they were).
+	bool filledLooksEmpty = false;
+	if (IsFlagSet(dwDrawEnable, PicScreenFlags::Visual))
 	{
-		return;
-	}
-
-	for (;;)
-	{
-		p = qretrieve(&rpos);
-		x1 = p.x;
-		y1 = p.y;
-
-		if ((x1 == EMPTY) || (y1 == EMPTY))
+		filledLooksEmpty = !IsFlagSet(pdata->dwMapsToRedraw, PicScreenFlags::Visual);
+		for (int16_t parity = 0; parity < 4; parity++)
 		{
-			return;
+			int16_t xParity = parity & 1;
+			int16_t yParity = parity >> 1;
+			filledLooksEmpty = filledLooksEmpty || _TFormat::IsPixelWhite(_TFormat::Plot(xParity, yParity, color), xParity, yParity);
 		}
-		else
-		{
-			if (OK_TO_FILL(cx, cy, x1, y1, _TFormat))
-			{
-				_PlotPix<_TFormat, PlotPixTool::Fill>(pdata, (int16_t)x1, (int16_t)y1, dwDrawEnable, auxSet, color, bPriorityValue, bControlValue);
-
-				// PERF: Tried removing OK_TO_FILL here, but it made it worse
-				// (It's technically uncessary)
-				if ((y1 != 0) && OK_TO_FILL(cx, cy, x1, y1 - 1, _TFormat))
-				{
-					if (!qstore(displayByteSize, x1, y1 - 1, &rpos)) break;
-				}
-				if ((x1 != 0) && OK_TO_FILL(cx, cy, x1 - 1, y1, _TFormat))
-				{  
-					if (!qstore(displayByteSize, x1 - 1, y1, &rpos)) break;
-				}
-				if ((x1 != xMax) && OK_TO_FILL(cx, cy, x1 + 1, y1, _TFormat))
-				{ 
-					if (!qstore(displayByteSize, x1 + 1, y1, &rpos)) break;;
-				}
-				if ((y1 != yMax) && OK_TO_FILL(cx, cy, x1, y1 + 1, _TFormat))
-				{
-					if (!qstore(displayByteSize, x1, y1 + 1, &rpos)) break;;
-				}
-
-				g_commands += 4;
-			}
+	}
 
-		}
+	if (filledLooksEmpty)
+	{
+		_StackFill<_TFormat>(pdata, x, y, color, bPriorityValue, bControlValue, dwDrawEnable);
+	}
+	else
+	{
+		_ScanlineFill<_TFormat>(pdata, x, y, color, bPriorityValue, bControlValue, dwDrawEnable);
 	}
 }
 
@@ -2213,6 +2247,120 @@ void DisableControlCommand_Serialize(sci::ostream *pSerial, const PicCommand *pC
 }
 
 
+//
+// PAYLOADS
+//
+// Palettes, priority bars and cels are shared by all copies of a command (in the undo history, on the
+// clipboard, in Clone()'d pics), so copying a pic just copies the small command structures. The
+// reference count lives just before the payload, so the unions don't get any bigger.
+//
+namespace
+{
+	struct PayloadHeader
+	{
+		std::atomic<long> refCount;
+	};
+	// So the payload stays aligned
+	const size_t PayloadHeaderSize = 8;
+	static_assert(sizeof(PayloadHeader) <= PayloadHeaderSize, "PayloadHeader is too big");
+
+	PayloadHeader *_GetPayloadHeader(const void *payload)
+	{
+		return reinterpret_cast<PayloadHeader*>(const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(payload)) - PayloadHeaderSize);
+	}
+
+	template<typename T>
+	T *_AllocPayload(size_t count, const T *src = nullptr)
+	{
+		uint8_t *block = static_cast<uint8_t*>(::operator new(PayloadHeaderSize + sizeof(T) * count));
+		PayloadHeader *header = new (block) PayloadHeader();
+		header->refCount = 1;
+		T *payload = reinterpret_cast<T*>(block + PayloadHeaderSize);
+		for (size_t i = 0; i < count; i++)
+		{
+			if (src)
+			{
+				new (payload + i) T(src[i]);
+			}
+			else
+			{
+				new (payload + i) T();
+			}
+		}
+		return payload;
+	}
+
+	void _AddRefPayload(const void *payload)
+	{
+		if (payload)
+		{
+			_GetPayloadHeader(payload)->refCount++;
+		}
+	}
+
+	template<typename T>
+	void _ReleasePayload(T *payload, size_t count)
+	{
+		if (payload)
+		{
+			PayloadHeader *header = _GetPayloadHeader(payload);
+			if (--header->refCount == 0)
+			{
+				for (size_t i = 0; i < count; i++)
+				{
+					payload[i].~T();
+				}
+				header->~PayloadHeader();
+				::operator delete(header);
+			}
+		}
+	}
+
+	// Gives this owner its own copy of the payload if anyone else is using it.
+	template<typename T>
+	T *_MakePayloadUnique(T *payload, size_t count)
+	{
+		if (payload && (_GetPayloadHeader(payload)->refCount > 1))
+		{
+			T *copy = _AllocPayload<T>(count, payload);
+			_ReleasePayload(payload, count);
+			payload = copy;
+		}
+		return payload;
+	}
+}
+
+bool PicCommand::IsPayloadShared(const PicCommand &one, const PicCommand &two)
+{
+	if (one.type == two.type)
+	{
+		switch (one.type)
+		{
+			case SetPalette:
+				return one.setPalette.pPalette == two.setPalette.pPalette;
+			case SetPriorityBars:
+				return one.setPriorityBars.pPriorityLines == two.setPriorityBars.pPriorityLines;
+			case DrawBitmap:
+				return one.drawVisualBitmap.pCel == two.drawVisualBitmap.pCel;
+		}
+	}
+	return false;
+}
+
+Cel &PicCommand::GetWritableCel()
+{
+	assert(type == DrawBitmap);
+	drawVisualBitmap.pCel = _MakePayloadUnique(drawVisualBitmap.pCel, 1);
+	return *drawVisualBitmap.pCel;
+}
+
+uint16_t *PicCommand::GetWritablePriorityLines()
+{
+	assert(type == SetPriorityBars);
+	setPriorityBars.pPriorityLines = _MakePayloadUnique(setPriorityBars.pPriorityLines, NumPriorityBars);
+	return setPriorityBars.pPriorityLines;
+}
+
 //
 // PALETTES
 //
@@ -2221,14 +2369,8 @@ void PicCommand::_CreateSetPalette(uint8_t bPaletteNumber, const EGACOLOR *pPale
 	assert(_IsEmpty());
 	type = SetPalette;
 	setPalette.bPaletteNumber = bPaletteNumber;
-	setPalette.pPalette = new EGACOLOR[PALETTE_SIZE];
 	assert(sizeof(uint8_t) == sizeof(EGACOLOR));
-	if (setPalette.pPalette)
-	{
-		// If we're experiencing memory stress, then we won't set the palette
-		// here, and the pic will be corrupted. Oh well.
-		CopyMemory(setPalette.pPalette, pPalette, PALETTE_SIZE);
-	}
+	setPalette.pPalette = _AllocPayload<EGACOLOR>(PALETTE_SIZE, pPalette);
 }
 
 void SetPaletteCommand_Draw(const PicCommand *pCommand, PicData *pData, ViewPort *pState)
@@ -2322,10 +2464,9 @@ void PicCommand::CreateSetPriorityBars(const uint16_t *pBars, bool is16Bit, bool
 {
 	assert(_IsEmpty());
 	type = SetPriorityBars;
-	setPriorityBars.pPriorityLines = new uint16_t[NumPriorityBars];
+	setPriorityBars.pPriorityLines = _AllocPayload<uint16_t>(NumPriorityBars, pBars);
 	setPriorityBars.is16Bit = is16Bit;
 	setPriorityBars.isVGA = isVGA;
-	CopyMemory(setPriorityBars.pPriorityLines, pBars, NumPriorityBars * sizeof(*setPriorityBars.pPriorityLines));
 }
 
 void SetPriorityBarsCommand_Draw(const PicCommand *pCommand, PicData *pData, ViewPort *pState)
@@ -2362,7 +2503,7 @@ void PicCommand::CreateDrawVisualBitmap(const Cel &cel, bool isVGA, int16_t prio
 {
 	assert(_IsEmpty());
 	type = DrawBitmap;
-	drawVisualBitmap.pCel = new Cel(cel);
+	drawVisualBitmap.pCel = _AllocPayload<Cel>(1, &cel);
 	drawVisualBitmap.isVGA = isVGA;
 	drawVisualBitmap.priority = priority;   // SCI2 only
 }
@@ -2372,7 +2513,7 @@ void DrawVisualBitmap_Draw(const PicCommand *pCommand, PicData *pData, ViewPort
 	if (pCommand->drawVisualBitmap.pCel)
 	{
 		size16 displaySize = pData->size;
-		Cel &cel = *pCommand->drawVisualBitmap.pCel;
+		const Cel &cel = *pCommand->drawVisualBitmap.pCel;
 		// Optimization
 #if CANT_DO_BECAUSE_OF_TRANS_COLOR
 		if ((cel.size.cx == pData->size.cx) && (cel.size.cy == pData->size.cy))
@@ -2417,6 +2558,11 @@ void DrawVisualBitmap_Draw(const PicCommand *pCommand, PicData *pData, ViewPort
 			for (int x = max(0, cel.placement.x); x < min(pData->size.cx, (cel.placement.x + cel.size.cx)); x++)
 			{
 				pData->pdataAux[BUFFEROFFSET_NONSTD(displaySize.cx, displaySize.cy, x, y)] |= (uint8_t)PicScreenFlags::Visual;
+				if (pData->pdataWriters[0])
+				{
+					// Not exact (it ignores transparency), but good enough to find the bitmap.
+					pData->pdataWriters[0][BUFFEROFFSET_NONSTD(displaySize.cx, displaySize.cy, x, y)] = pData->currentCommand;
+				}
 			}
 		}
 
@@ -2597,23 +2743,20 @@ PicCommand::PicCommand()
 	type = None;
 }
 
-// Do a deep copy of certain commands
-void PicCommand::_MaybeDeepCopy(const PicCommand &src)
+// Share the payload of certain commands
+void PicCommand::_SharePayload(const PicCommand &src)
 {
 	if (src.type == SetPalette)
 	{
-		// Reallocate the palette
-		setPalette.pPalette = new EGACOLOR[PALETTE_SIZE];
-		memcpy(setPalette.pPalette, src.setPalette.pPalette, sizeof(EGACOLOR) * PALETTE_SIZE);
+		_AddRefPayload(src.setPalette.pPalette);
 	}
 	else if (src.type == DrawBitmap)
 	{
-		drawVisualBitmap.pCel = new Cel(*src.drawVisualBitmap.pCel);
+		_AddRefPayload(src.drawVisualBitmap.pCel);
 	}
 	else if (src.type == SetPriorityBars)
 	{
-		setPriorityBars.pPriorityLines = new uint16_t[NumPriorityBars];
-		memcpy(setPriorityBars.pPriorityLines, src.setPriorityBars.pPriorityLines, NumPriorityBars * sizeof(*setPriorityBars.pPriorityLines));
+		_AddRefPayload(src.setPriorityBars.pPriorityLines);
 	}
 }
 
@@ -2621,7 +2764,15 @@ void PicCommand::_MaybeDeepCopy(const PicCommand &src)
 PicCommand::PicCommand(const PicCommand& src)
 {
 	memcpy(this, &src, sizeof(PicCommand));
-	_MaybeDeepCopy(src);
+	_SharePayload(src);
+}
+
+PicCommand::PicCommand(PicCommand&& src) noexcept
+{
+	// Take the payload.
+	memcpy(this, &src, sizeof(PicCommand));
+	memset(&src, 0, sizeof(PicCommand));
+	src.type = None;
 }
 
 // For deserialization from clipboard:
@@ -2636,17 +2787,17 @@ bool PicCommand::Initialize(sci::istream &byteStream)
 		if (type == SetPalette)
 		{
 			// Allocate the palette
-			setPalette.pPalette = new EGACOLOR[PALETTE_SIZE];
+			setPalette.pPalette = _AllocPayload<EGACOLOR>(PALETTE_SIZE);
 			byteStream.read_data((uint8_t*)setPalette.pPalette, sizeof(*setPalette.pPalette) * PALETTE_SIZE);
 		}
 		else if (type == SetPriorityBars)
 		{
-			setPriorityBars.pPriorityLines = new uint16_t[NumPriorityBars];
+			setPriorityBars.pPriorityLines = _AllocPayload<uint16_t>(NumPriorityBars);
 			byteStream.read_data((uint8_t*)setPriorityBars.pPriorityLines, sizeof(*setPriorityBars.pPriorityLines) * NumPriorityBars);
 		}
 		else if (type == DrawBitmap)
 		{
-			drawVisualBitmap.pCel = new Cel();
+			drawVisualBitmap.pCel = _AllocPayload<Cel>(1);
 			DeserializeCelRuntime(byteStream, *drawVisualBitmap.pCel);
 		}
 	}
@@ -2680,9 +2831,21 @@ PicCommand& PicCommand::operator=(const PicCommand& src)
 {
 	if (this != &src)
 	{
-		_CleanUp(); // Delete any existing data.
+		_CleanUp(); // Release any existing data.
+		memcpy(this, &src, sizeof(PicCommand));
+		_SharePayload(src);
+	}
+	return(*this);
+}
+
+PicCommand& PicCommand::operator=(PicCommand&& src) noexcept
+{
+	if (this != &src)
+	{
+		_CleanUp();
 		memcpy(this, &src, sizeof(PicCommand));
-		_MaybeDeepCopy(src);
+		memset(&src, 0, sizeof(PicCommand));
+		src.type = None;
 	}
 	return(*this);
 }
@@ -2695,19 +2858,19 @@ bool PicCommand::_IsEmpty()
 
 void PicCommand::_CleanUp()
 {
-	// Clean up any allocated data
+	// Release any allocated data
 	switch (type)
 	{
 	case SetPalette:
-		delete[] setPalette.pPalette;
+		_ReleasePayload(setPalette.pPalette, PALETTE_SIZE);
 		setPalette.pPalette = nullptr;
 		break;
 	case SetPriorityBars:
-		delete[] setPriorityBars.pPriorityLines;
+		_ReleasePayload(setPriorityBars.pPriorityLines, NumPriorityBars);
 		setPriorityBars.pPriorityLines = nullptr;
 		break;
 	case DrawBitmap:
-		delete drawVisualBitmap.pCel;
+		_ReleasePayload(drawVisualBitmap.pCel, 1);
 		drawVisualBitmap.pCel = nullptr;
 		break;
 	}
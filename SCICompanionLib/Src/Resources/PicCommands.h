@@ -25,6 +25,7 @@ namespace sci
 #include "PicCommandsCommon.h"
 #include "Components.h" // Cel
 #include "DrawPixelCallback.h"
+#include "PriorityComposite.h"
 
 // fwd decl
 class ResourceEntity;
@@ -108,6 +109,11 @@ struct PicData
 	// Optional callback when a pixel is drawn
 	DrawPixelCallback drawPixelCallback;
 
+	// Optional: for each pixel, the index of the last command that changed it (indexed by PicScreen, but
+	// there's none for aux). Set currentCommand before drawing each command.
+	uint16_t *pdataWriters[3];
+	uint16_t currentCommand;
+
 	void EnsureInBounds(int &x, int &y);
 };
 
@@ -232,10 +238,12 @@ extern const int16_t InvalidPri;
 // PicCommand*, as the memory allocations hurt performance.
 //
 // So the PicCommand class contains a union of all the possible data required for a
-// command.  However, the setPalette command is unique in that it requires much more
-// data (a whole palette).  So we allocate a palette in this object (palette commands
-// are infrequent, so perf is not an issue).  Since we have an allocated object here, we
-// need a destructor, copy constructor, and an = operator overload.
+// command.  However, a few commands require much more data (a whole palette, the priority
+// bars, or a bitmap).  That's allocated separately, and shared (reference counted) between
+// copies of the command, so copying a pic (for undo, the clipboard, etc...) doesn't copy the
+// bitmaps.  Since we have an allocated object here, we need a destructor, copy constructor,
+// and an = operator overload.  Use GetWritableCel/GetWritablePriorityLines to modify the
+// shared data.
 //
 class PicCommand
 {
@@ -268,14 +276,21 @@ public:
 
 	PicCommand();
 	PicCommand(const PicCommand& src);
+	PicCommand(PicCommand&& src) noexcept;
 	// For deserialization from clipboard:
 	bool Initialize(sci::istream &byteStream);
 	// Serialization for clipboard
 	void SerializeForClipboard(sci::ostream *pSerial) const;
 	~PicCommand();
 	PicCommand& operator=(const PicCommand& src);
+	PicCommand& operator=(PicCommand&& src) noexcept;
+
+	void _SharePayload(const PicCommand &src);
 
-	void _MaybeDeepCopy(const PicCommand &src);
+	// These make a copy of the data first if another command shares it.
+	Cel &GetWritableCel();
+	uint16_t *GetWritablePriorityLines();
+	static bool IsPayloadShared(const PicCommand &one, const PicCommand &two);
 
 	// We achieve our polymorphism via unions. This avoids us having to allocate
 	// a chunk of memory for each command (only certain commands with extra data
@@ -504,6 +519,8 @@ extern const EGACOLOR *g_defaultPalette;
 // For the fake ego feature.
 //
 void DrawBoxWithPriority(size16 picSize, uint8_t *pdataDisplay, const uint8_t *pdataPriority, uint8_t bEgoPriority, int16_t x, int16_t y, uint16_t cx, uint16_t cy, bool isDithered);
+// Draws a bottom-up image (e.g. a cel's data) onto a pic, clipped to the pic. kernel is just for testing.
+void DrawImageWithPriority(size16 displaySize, uint8_t *pdataDisplay, const uint8_t *pdataPriority, uint8_t *pdataPriorityWrite, uint8_t bEgoPriority, int xLeft, int yTop, uint16_t cx, uint16_t cy, uint16_t cxStride, const uint8_t *pImageData, uint8_t transparent, bool fShowOutline, bool isEGAUndithered, CompositeKernel kernel = CompositeKernel::Best);
 CRect DrawViewWithPriority(size16 displaySize, uint8_t *pdataDisplay, const uint8_t *pdataPriority, uint8_t bEgoPriority, int16_t xIn, int16_t yIn, const ResourceEntity *pvr, int nLoop, int nCel, bool fShowOutline = false, bool isEGAUndithered = false);
 bool HitTestEgoBox(int16_t xCursor, int16_t yCursor, int16_t xEgo, int16_t yEgo, uint16_t cx, uint16_t cy);
 bool HitTestView(int16_t xCursor, int16_t yCursor, int16_t xEgo, int16_t yEgo, const ResourceEntity *pvr, int nLoop, int nCel);
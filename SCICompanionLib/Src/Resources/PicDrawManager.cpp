@@ -23,6 +23,27 @@
 
 using namespace Gdiplus;
 
+// A copy of the PrePlugin buffers part way through the pic, so that seeking doesn't need to redraw from the start.
+struct PicCheckpoint
+{
+	ptrdiff_t Position;		// Number of commands drawn
+	ViewPort State;			// The state after drawing them
+	uint8_t *Buffers[4];	// Indexed by PicScreen (null for screens that weren't drawn)
+	bool HasWriters;
+	uint16_t *Writers[3];
+};
+
+// Take a checkpoint after this many commands, or after this much time spent drawing (fills can be slow),
+// whichever comes first.
+const ptrdiff_t CheckpointCommandInterval = 200;
+const std::chrono::milliseconds CheckpointTimeInterval(20);
+// We also take one at the position we were asked to draw to (since that's where edits happen), unless
+// it's very close to the previous one.
+const ptrdiff_t CheckpointMinimumGap = 16;
+
+// In the writers buffers, for pixels no command has changed.
+const uint16_t NoWriter = 0xffff;
+
 PicScreenFlags PicScreenToFlags(PicScreen screen)
 {
 	return (PicScreenFlags)(0x1 << (int)screen);
@@ -39,7 +60,13 @@ PicDrawManager::PicDrawManager(const PicComponent *pPic, const PaletteComponent
 	_isVGA(pPalette != nullptr),
 	_isContinuousPri(pPic && pPic->Traits->ContinuousPriority),
 	_isUndithered(isEGAUndithered),
-	_screenBuffers{}
+	_screenBuffers{},
+	_checkpointScreens(PicScreenFlags::None),
+	_checkpointBudget(DefaultCheckpointBudget),
+	_trackWriters(false),
+	_writersSize(0),
+	_writersScreens(PicScreenFlags::None),
+	_writersComplete(false)
 {
 	_viewPorts = std::make_unique<ViewPort[]>(3);
 	_Reset();
@@ -54,13 +81,17 @@ PicDrawManager::PicDrawManager(const PicComponent *pPic, const PaletteComponent
 	}
 }
 
+PicDrawManager::~PicDrawManager() {}
+
 void PicDrawManager::_EnsureBufferPool(size16 size)
 {
 	size_t byteSize = size.cx * size.cy;
 	if (!_bufferPool || (_bufferPool->GetSize() != byteSize))
 	{
-		_bufferPool = std::make_unique<BufferPool<12>>(byteSize);
 		Invalidate();
+		_bufferPool = std::make_unique<BufferPool<12>>(byteSize);
+		_checkpointPool = std::make_unique<BufferPool<MaxCheckpoints * 4>>(byteSize);
+		_checkpointWriterPool = std::make_unique<BufferPool<MaxCheckpoints * 3>>(byteSize * sizeof(uint16_t));
 	}
 }
 
@@ -91,12 +122,21 @@ void PicDrawManager::_Reset()
 
 void PicDrawManager::SetPic(const PicComponent *pPic, const PaletteComponent *pPalette, bool isEGAUndithered)
 {
+	bool isContinuousPri = pPic && pPic->Traits->ContinuousPriority;
+	if ((_isUndithered != isEGAUndithered) || (_isVGA != (pPalette != nullptr)) || (_isContinuousPri != isContinuousPri))
+	{
+		// These change how things are drawn.
+		_ClearCheckpoints();
+		_writersComplete = false;
+	}
 	_isUndithered = isEGAUndithered;
 	_isVGA = (pPalette != nullptr);
-	_isContinuousPri = pPic && pPic->Traits->ContinuousPriority;
+	_isContinuousPri = isContinuousPri;
 	if (!IsSame(pPic, _pPicWeak))
 	{
 		_Reset();
+		_ClearCheckpoints();
+		_writersComplete = false;
 	}
 	_pPicWeak = pPic;
 	if (pPalette)
@@ -204,6 +244,8 @@ void PicDrawManager::SetPalette(uint8_t bPaletteNumber)
 		_fValidPalette = false; // Since the palette changed.
 		_fValidScreens = PicScreenFlags::None;
 		_fValidState = false;
+		_ClearCheckpoints();
+		_writersComplete = false;
 	}
 }
 
@@ -321,24 +363,6 @@ void PicDrawManager::_RedrawBuffers(ViewPort *pState, PicScreenFlags screenFlags
 	// when we're drawing lines and such in the editor.
 	if (!IsFlagSet(_validPositions, PicPositionFlags::PrePlugin))
 	{
-		// Our initial viewport state.
-		_viewPorts[0] = *pState;
-
-		// Default states
-		if (IsFlagSet(screenFlags, PicScreenFlags::Priority))
-		{
-			memset(GetScreenData(PicScreen::Priority, PicPosition::PrePlugin), 0x00, _bufferPool->GetSize());
-		}
-		if (IsFlagSet(screenFlags, PicScreenFlags::Control))
-		{
-			memset(GetScreenData(PicScreen::Control, PicPosition::PrePlugin), 0x00, _bufferPool->GetSize());
-		}
-		if (IsFlagSet(screenFlags, PicScreenFlags::Visual))
-		{
-			memset(GetScreenData(PicScreen::Visual, PicPosition::PrePlugin), (_isVGA || _isUndithered) ? 0xff : 0x0f, _bufferPool->GetSize());
-		}
-		memset(GetScreenData(PicScreen::Aux, PicPosition::PrePlugin), 0x00, _bufferPool->GetSize());
-
 		PicData data =
 		{
 			screenFlags,
@@ -353,8 +377,53 @@ void PicDrawManager::_RedrawBuffers(ViewPort *pState, PicScreenFlags screenFlags
 			drawPixelCallback
 		};
 
+		bool trackWriters = !drawPixelCallback && _CanTrackWriters() && IsFlagSet(screenFlags, PicScreenFlags::Visual);
+		if (trackWriters)
+		{
+			_AttachWriters(data);
+		}
+
+		// Start from the closest checkpoint, if we have one. The pixel callback needs to see everything
+		// though, so don't use them then.
+		bool useCheckpoints = !drawPixelCallback && _UseCheckpoints(screenFlags);
+		ptrdiff_t iStart = useCheckpoints ? _RestoreCheckpoint(data, _viewPorts[0], _iDrawPos) : 0;
+		if (iStart == 0)
+		{
+			// Our initial viewport state.
+			_viewPorts[0] = *pState;
+
+			// Default states
+			if (IsFlagSet(screenFlags, PicScreenFlags::Priority))
+			{
+				memset(GetScreenData(PicScreen::Priority, PicPosition::PrePlugin), 0x00, _bufferPool->GetSize());
+			}
+			if (IsFlagSet(screenFlags, PicScreenFlags::Control))
+			{
+				memset(GetScreenData(PicScreen::Control, PicPosition::PrePlugin), 0x00, _bufferPool->GetSize());
+			}
+			if (IsFlagSet(screenFlags, PicScreenFlags::Visual))
+			{
+				memset(GetScreenData(PicScreen::Visual, PicPosition::PrePlugin), (_isVGA || _isUndithered) ? 0xff : 0x0f, _bufferPool->GetSize());
+			}
+			memset(GetScreenData(PicScreen::Aux, PicPosition::PrePlugin), 0x00, _bufferPool->GetSize());
+			_ResetWriters(data);
+		}
+
 		// Now draw!
-		Draw(*_pPicWeak, data, _viewPorts[0], 0, _iDrawPos);
+		if (useCheckpoints)
+		{
+			_DrawWithCheckpoints(data, _viewPorts[0], iStart, _iDrawPos);
+		}
+		else
+		{
+			Draw(*_pPicWeak, data, _viewPorts[0], 0, _iDrawPos);
+		}
+
+		if (trackWriters)
+		{
+			_writersScreens = screenFlags;
+			_writersComplete = atFinalPosition;
+		}
 	}
 
 	// Perf optimization: if no one is drawing on the pic, then we can "skip" this step
@@ -441,6 +510,297 @@ void PicDrawManager::_RedrawBuffers(ViewPort *pState, PicScreenFlags screenFlags
 	_fValidScreens = screenFlags;
 }
 
+//
+// Keep it simple: all checkpoints are for the same set of screens. If fewer screens are being drawn
+// (e.g. someone just wants the ViewPort), leave the checkpoints alone for next time.
+//
+bool PicDrawManager::_UseCheckpoints(PicScreenFlags screenFlags)
+{
+	if (screenFlags != _checkpointScreens)
+	{
+		if (!_checkpoints.empty() && AreAllFlagsSet(_checkpointScreens, screenFlags))
+		{
+			return false;
+		}
+		_ClearCheckpoints();
+		_checkpointScreens = screenFlags;
+	}
+	return true;
+}
+
+//
+// Copies the closest checkpoint at or before iEnd into data's buffers (and writers, if it has them) and
+// state, and returns its position. Returns 0 if there was nothing suitable (and the buffers still need to
+// be initialized).
+//
+ptrdiff_t PicDrawManager::_RestoreCheckpoint(PicData &data, ViewPort &state, ptrdiff_t iEnd)
+{
+	if (iEnd == -1)
+	{
+		iEnd = (ptrdiff_t)_pPicWeak->commands.size();
+	}
+	auto it = std::upper_bound(_checkpoints.begin(), _checkpoints.end(), iEnd,
+		[](ptrdiff_t value, const PicCheckpoint &checkpoint) { return value < checkpoint.Position; });
+	// If we're tracking writers, we need a checkpoint that has them.
+	bool needWriters = (data.pdataWriters[0] != nullptr);
+	while ((it != _checkpoints.begin()) && ((it - 1)->HasWriters != needWriters))
+	{
+		--it;
+	}
+	if (it == _checkpoints.begin())
+	{
+		return 0;
+	}
+	--it;
+
+	uint8_t *dest[4] = { data.pdataVisual, data.pdataPriority, data.pdataControl, data.pdataAux };
+	for (int i = 0; i < 4; i++)
+	{
+		if (IsFlagSet(data.dwMapsToRedraw, (PicScreenFlags)(0x1 << i)))
+		{
+			memcpy(dest[i], it->Buffers[i], _checkpointPool->GetSize());
+		}
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		if (data.pdataWriters[i])
+		{
+			memcpy(data.pdataWriters[i], it->Writers[i], _checkpointWriterPool->GetSize());
+		}
+	}
+	state = it->State;
+	return it->Position;
+}
+
+//
+// Draws commands iStart through iEnd (-1 for the end) onto data, taking checkpoints along the way.
+//
+void PicDrawManager::_DrawWithCheckpoints(PicData &data, ViewPort &state, ptrdiff_t iStart, ptrdiff_t iEnd)
+{
+	ptrdiff_t commandCount = (ptrdiff_t)_pPicWeak->commands.size();
+	if ((iEnd == -1) || (iEnd > commandCount))
+	{
+		iEnd = commandCount;
+	}
+	if (_GetMaxCheckpoints() == 0)
+	{
+		Draw(*_pPicWeak, data, state, iStart, iEnd);
+		return;
+	}
+
+	ptrdiff_t lastCheckpoint = iStart;
+	auto lastCheckpointTime = std::chrono::steady_clock::now();
+	for (ptrdiff_t i = iStart; i < iEnd; i++)
+	{
+		data.currentCommand = (uint16_t)i;
+		_pPicWeak->commands[i].Draw(&data, state);
+
+		ptrdiff_t position = i + 1;
+		ptrdiff_t sinceLast = position - lastCheckpoint;
+		auto now = std::chrono::steady_clock::now();
+		if ((sinceLast >= CheckpointCommandInterval) ||
+			((now - lastCheckpointTime) >= CheckpointTimeInterval) ||
+			((position == iEnd) && (sinceLast >= CheckpointMinimumGap)))
+		{
+			_AddCheckpoint(data, state, position);
+			lastCheckpoint = position;
+			lastCheckpointTime = std::chrono::steady_clock::now();	// Don't count the time to copy
+		}
+	}
+}
+
+void PicDrawManager::_AddCheckpoint(const PicData &data, const ViewPort &state, ptrdiff_t position)
+{
+	auto it = std::upper_bound(_checkpoints.begin(), _checkpoints.end(), position,
+		[](ptrdiff_t value, const PicCheckpoint &checkpoint) { return value < checkpoint.Position; });
+	if ((it != _checkpoints.begin()) && ((it - 1)->Position == position))
+	{
+		return;	// Already have it
+	}
+	it = _checkpoints.insert(it, PicCheckpoint{ position, state, {}, (data.pdataWriters[0] != nullptr), {} });
+
+	if (_checkpoints.size() > _GetMaxCheckpoints())
+	{
+		// Evict the one whose removal leaves the smallest gap, so the ones we keep stay spread out.
+		ptrdiff_t commandCount = (ptrdiff_t)_pPicWeak->commands.size();
+		size_t evict = 0;
+		ptrdiff_t smallestGap = PTRDIFF_MAX;
+		for (size_t i = 0; i < _checkpoints.size(); i++)
+		{
+			ptrdiff_t prev = (i > 0) ? _checkpoints[i - 1].Position : 0;
+			ptrdiff_t next = ((i + 1) < _checkpoints.size()) ? _checkpoints[i + 1].Position : commandCount;
+			if ((_checkpoints[i].Position != position) && ((next - prev) < smallestGap))
+			{
+				smallestGap = next - prev;
+				evict = i;
+			}
+		}
+		_FreeCheckpoint(_checkpoints[evict]);
+		_checkpoints.erase(_checkpoints.begin() + evict);
+		it = std::find_if(_checkpoints.begin(), _checkpoints.end(), [position](const PicCheckpoint &checkpoint) { return checkpoint.Position == position; });
+	}
+
+	uint8_t *source[4] = { data.pdataVisual, data.pdataPriority, data.pdataControl, data.pdataAux };
+	for (int i = 0; i < 4; i++)
+	{
+		if (IsFlagSet(_checkpointScreens, (PicScreenFlags)(0x1 << i)))
+		{
+			it->Buffers[i] = _checkpointPool->AllocateBuffer();
+			memcpy(it->Buffers[i], source[i], _checkpointPool->GetSize());
+		}
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		if (data.pdataWriters[i])
+		{
+			it->Writers[i] = reinterpret_cast<uint16_t*>(_checkpointWriterPool->AllocateBuffer());
+			memcpy(it->Writers[i], data.pdataWriters[i], _checkpointWriterPool->GetSize());
+		}
+	}
+}
+
+void PicDrawManager::_FreeCheckpoint(PicCheckpoint &checkpoint)
+{
+	for (uint8_t *&buffer : checkpoint.Buffers)
+	{
+		_checkpointPool->FreeBuffer(buffer);
+		buffer = nullptr;
+	}
+	for (uint16_t *&writers : checkpoint.Writers)
+	{
+		_checkpointWriterPool->FreeBuffer(reinterpret_cast<uint8_t*>(writers));
+		writers = nullptr;
+	}
+}
+
+void PicDrawManager::_ClearCheckpoints()
+{
+	for (PicCheckpoint &checkpoint : _checkpoints)
+	{
+		_FreeCheckpoint(checkpoint);
+	}
+	_checkpoints.clear();
+}
+
+size_t PicDrawManager::_GetMaxCheckpoints() const
+{
+	size_t checkpointSize = _checkpointPool ? (_checkpointPool->GetSize() * 4) : 0;
+	if (_trackWriters && _checkpointWriterPool)
+	{
+		checkpointSize += _checkpointWriterPool->GetSize() * 3;
+	}
+	return checkpointSize ? (std::min)((size_t)MaxCheckpoints, _checkpointBudget / checkpointSize) : 0;
+}
+
+void PicDrawManager::SetCheckpointBudget(size_t bytes)
+{
+	_checkpointBudget = bytes;
+	_ClearCheckpoints();
+}
+
+void PicDrawManager::SetTrackWriters(bool track)
+{
+	if (track != _trackWriters)
+	{
+		_trackWriters = track;
+		_writersComplete = false;
+		// Checkpoints either all have writers or none do.
+		_ClearCheckpoints();
+		if (!track)
+		{
+			for (auto &writers : _writers)
+			{
+				writers.reset();
+			}
+			_writersSize = 0;
+		}
+	}
+}
+
+bool PicDrawManager::_CanTrackWriters() const
+{
+	return _trackWriters && _pPicWeak && (_pPicWeak->commands.size() < NoWriter);
+}
+
+void PicDrawManager::_AttachWriters(PicData &data)
+{
+	size_t byteSize = _bufferPool->GetSize();
+	if (_writersSize != byteSize)
+	{
+		for (auto &writers : _writers)
+		{
+			writers = std::make_unique<uint16_t[]>(byteSize);
+		}
+		_writersSize = byteSize;
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		data.pdataWriters[i] = IsFlagSet(data.dwMapsToRedraw, (PicScreenFlags)(0x1 << i)) ? _writers[i].get() : nullptr;
+	}
+}
+
+void PicDrawManager::_ResetWriters(PicData &data)
+{
+	for (uint16_t *writers : data.pdataWriters)
+	{
+		if (writers)
+		{
+			std::fill_n(writers, _writersSize, NoWriter);
+		}
+	}
+}
+
+//
+// Draws the whole pic into scratch buffers, just to fill in the writers. This starts from a checkpoint if
+// there's one with the screen we need.
+//
+void PicDrawManager::_DrawWriters(PicScreen screen)
+{
+	PicScreenFlags screenFlags = PicScreenFlags::Visual | PicScreenFlags::Priority | PicScreenFlags::Control | PicScreenFlags::Aux;
+	bool useCheckpoints = !_checkpoints.empty() && IsFlagSet(_checkpointScreens, PicScreenToFlags(screen));
+	if (useCheckpoints)
+	{
+		screenFlags = _checkpointScreens;
+	}
+
+	size_t byteSize = _bufferPool->GetSize();
+	std::vector<uint8_t> pdataVisual(byteSize, (_isVGA || _isUndithered) ? 0xff : 0x0f);
+	std::vector<uint8_t> pdataPriority(byteSize, 0x00);
+	std::vector<uint8_t> pdataControl(byteSize, 0x00);
+	std::vector<uint8_t> pdataAux(byteSize, 0x00);
+	PicData data =
+	{
+		screenFlags,
+		&pdataVisual[0],
+		&pdataPriority[0],
+		&pdataControl[0],
+		&pdataAux[0],
+		_isVGA,
+		_isUndithered,
+		_GetPicSize(),
+		_isContinuousPri,
+		nullptr
+	};
+	_AttachWriters(data);
+
+	ViewPort state(_bPaletteNumber);
+	ptrdiff_t iStart = useCheckpoints ? _RestoreCheckpoint(data, state, -1) : 0;
+	if (iStart == 0)
+	{
+		_ResetWriters(data);
+	}
+	if (useCheckpoints)
+	{
+		_DrawWithCheckpoints(data, state, iStart, -1);
+	}
+	else
+	{
+		Draw(*_pPicWeak, data, state, 0, -1);
+	}
+	_writersScreens = screenFlags;
+	_writersComplete = true;
+}
+
 void PicDrawManager::_ReturnOldBufferIfNotUsedAnywhere(PicPosition pos)
 {
 	for (int screenIndex = 0; screenIndex < 4; screenIndex++)
@@ -677,10 +1037,28 @@ const ViewPort *PicDrawManager::GetViewPort(PicPosition pos)
 // Given a point, determines the position in the pic, before iState (-1 = end)
 // where that position changed.
 // Returns -1 if that point was never changed.
-// Currently only works for visual screen.
+// If we're tracking writers, this is just a lookup (and works for any screen but aux). Otherwise
+// it redraws the whole pic, and only works for the visual screen.
 //
-ptrdiff_t PicDrawManager::PosFromPoint(int x, int y, ptrdiff_t iStart)
+ptrdiff_t PicDrawManager::PosFromPoint(int x, int y, ptrdiff_t iStart, PicScreen screen)
 {
+	if (_CanTrackWriters() && (screen != PicScreen::Aux))
+	{
+		size16 size = _GetPicSize();
+		if ((x < 0) || (y < 0) || (x >= size.cx) || (y >= size.cy))
+		{
+			return -1;
+		}
+		_EnsureBufferPool(size);
+		if (!_writersComplete || !IsFlagSet(_writersScreens, PicScreenToFlags(screen)))
+		{
+			_DrawWriters(screen);
+		}
+		uint16_t writer = _writers[(int)screen][BUFFEROFFSET_NONSTD(size.cx, size.cy, x, y)];
+		return (writer == NoWriter) ? -1 : writer;
+	}
+
+	// Otherwise, draw everything and watch the pixel (only the visual screen is supported).
 	ViewPort state(0);
 	size16 size = _GetPicSize();
 	size_t byteSize = size.cx * size.cy;
@@ -729,6 +1107,27 @@ void PicDrawManager::AddPicPlugin(IPicDrawPlugin *plugin)
 }
 
 void PicDrawManager::Invalidate()
+{
+	_InvalidateScreens();
+	_ClearCheckpoints();
+	_writersComplete = false;
+}
+
+void PicDrawManager::InvalidateFrom(ptrdiff_t iCommand)
+{
+	_InvalidateScreens();
+	_writersComplete = false;
+	// A checkpoint at iCommand doesn't include that command, so it's still good.
+	auto it = std::upper_bound(_checkpoints.begin(), _checkpoints.end(), iCommand,
+		[](ptrdiff_t value, const PicCheckpoint &checkpoint) { return value < checkpoint.Position; });
+	for (auto itFree = it; itFree != _checkpoints.end(); ++itFree)
+	{
+		_FreeCheckpoint(*itFree);
+	}
+	_checkpoints.erase(it, _checkpoints.end());
+}
+
+void PicDrawManager::_InvalidateScreens()
 {
 	_fValidScreens = PicScreenFlags::None;
 	_fValidState = false;
@@ -736,7 +1135,8 @@ void PicDrawManager::Invalidate()
 
 void PicDrawManager::_OnPosChanged(bool fNotify)
 {
-	Invalidate();
+	// The commands haven't changed, so the checkpoints are still good.
+	_InvalidateScreens();
 }
 
 void PicDrawManager::InvalidatePlugins()
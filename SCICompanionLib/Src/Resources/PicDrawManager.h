@@ -21,6 +21,7 @@ struct PicData;
 struct PicComponent;
 struct PaletteComponent;
 struct Cel;
+struct PicCheckpoint;
 
 enum class PicPosition
 {
@@ -55,6 +56,7 @@ class PicDrawManager
 {
 public:
 	PicDrawManager(const PicComponent *pPic = nullptr, const PaletteComponent *pPalette = nullptr, bool isEGAUndithered = false);
+	~PicDrawManager();
 	void SetPic(const PicComponent *pPic, const PaletteComponent *pPalette, bool isEGAUndithered);
 	const PicComponent *GetPic() const { return _pPicWeak; }
 
@@ -69,10 +71,20 @@ public:
 	uint8_t GetPalette() { return _bPaletteNumber; }
 	const ViewPort *GetViewPort(PicPosition pos);
 	bool SeekToPos(ptrdiff_t iPos); // true if changed
-	ptrdiff_t PosFromPoint(int x, int y, ptrdiff_t iStart);
+	ptrdiff_t PosFromPoint(int x, int y, ptrdiff_t iStart, PicScreen screen = PicScreen::Visual);
 	ptrdiff_t GetPos() const { return _iInsertPos; }
 	void SetPreview(bool fPreview);
 	void Invalidate();
+	// Call this when commands at or after iCommand have changed (or been inserted or removed). Checkpoints before that are kept.
+	void InvalidateFrom(ptrdiff_t iCommand);
+
+	// Memory available for checkpoints. Zero turns them off.
+	static const size_t DefaultCheckpointBudget = 8 * 1024 * 1024;
+	void SetCheckpointBudget(size_t bytes);
+	size_t GetCheckpointCount() const { return _checkpoints.size(); }
+
+	// Keep track of which command last changed each pixel while drawing, so PosFromPoint is just a lookup.
+	void SetTrackWriters(bool track);
 
 	void AddPicPlugin(IPicDrawPlugin *plugin);
 
@@ -93,6 +105,18 @@ private:
 	HBITMAP _CreateBitmap(uint8_t *pData, size16 sizePic, int cxRequest, int cyRequest, const RGBQUAD *palette, int paletteCount, SCIBitmapInfo *pbmi = nullptr, uint8_t **pBitsDest = nullptr) const;
 	HBITMAP _GetBitmapGDIP(uint8_t *pData, int cx, int cy, const RGBQUAD *palette, int paletteCount) const;
 	void _OnPosChanged(bool fNotify = true);
+	void _InvalidateScreens();
+	void _ClearCheckpoints();
+	void _FreeCheckpoint(PicCheckpoint &checkpoint);
+	size_t _GetMaxCheckpoints() const;
+	bool _UseCheckpoints(PicScreenFlags screenFlags);
+	ptrdiff_t _RestoreCheckpoint(PicData &data, ViewPort &state, ptrdiff_t iEnd);
+	void _AddCheckpoint(const PicData &data, const ViewPort &state, ptrdiff_t position);
+	void _DrawWithCheckpoints(PicData &data, ViewPort &state, ptrdiff_t iStart, ptrdiff_t iEnd);
+	bool _CanTrackWriters() const;
+	void _AttachWriters(PicData &data);
+	void _ResetWriters(PicData &data);
+	void _DrawWriters(PicScreen screen);
 	size16 _GetPicSize() const;
 
 	uint8_t *GetScreenData(PicScreen screen, PicPosition pos);
@@ -115,6 +139,23 @@ private:
 	// Cached view port state for each of the 3 position buffers.
 	std::unique_ptr<ViewPort[]> _viewPorts;
 
+	// Checkpoints of the PrePlugin position, sorted by position. They're all for the same set of screens.
+	static const int MaxCheckpoints = 32;
+	std::unique_ptr<BufferPool<MaxCheckpoints * 4>> _checkpointPool;
+	std::unique_ptr<BufferPool<MaxCheckpoints * 3>> _checkpointWriterPool;
+	std::vector<PicCheckpoint> _checkpoints;
+	PicScreenFlags _checkpointScreens;
+	size_t _checkpointBudget;
+
+	// The index of the command that last changed each pixel, for the visual, priority and control screens.
+	// These are filled in while drawing the PrePlugin position. _writersComplete says whether that draw went
+	// all the way to the end, so they're good for PosFromPoint.
+	bool _trackWriters;
+	std::unique_ptr<uint16_t[]> _writers[3];
+	size_t _writersSize;
+	PicScreenFlags _writersScreens;
+	bool _writersComplete;
+
 	// Are the bitmaps valid? (note, if any of these are valid, then the aux is valid too)
 	PicScreenFlags _fValidScreens;
 	PicPositionFlags _validPositions;
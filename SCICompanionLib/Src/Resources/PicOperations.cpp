@@ -482,6 +482,7 @@ void Draw(const PicComponent &pic, PicData &data, ViewPort &state, ptrdiff_t iSt
 	for (ptrdiff_t i = iStart; i < iEnd; i++)
 	{
 		const PicCommand &command = pic.commands[i];
+		data.currentCommand = (uint16_t)i;
 		command.Draw(&data, state);
 	}
 }
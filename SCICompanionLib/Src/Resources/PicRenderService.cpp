@@ -0,0 +1,178 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#include "stdafx.h"
+#include "PicRenderService.h"
+#include "PicDrawManager.h"
+#include "Pic.h"
+#include "PngWriter.h"
+#include "ThreadPool.h"
+#include "format.h"
+#include <atomic>
+
+using namespace std;
+
+const char PicRenderService::TimingReportFilename[] = "render-timing.csv";
+
+namespace
+{
+	struct ScreenOutput
+	{
+		PicScreen Screen;
+		const char *Suffix;
+	};
+	const ScreenOutput c_screenOutputs[] =
+	{
+		{ PicScreen::Visual, "-vis" },
+		{ PicScreen::Priority, "-pri" },
+		{ PicScreen::Control, "-ctl" },
+	};
+
+	void _WriteFile(const string &filename, const uint8_t *data, size_t size)
+	{
+		ofstream file(filename, ios::out | ios::binary | ios::trunc);
+		file.write(reinterpret_cast<const char*>(data), size);
+		if (!file)
+		{
+			// Not std::exception(const char*), so this doesn't depend on the MS STL.
+			throw runtime_error("Unable to write " + filename);
+		}
+	}
+
+	// The same colors PicDrawManager::CreateBitmap uses.
+	const RGBQUAD *_GetScreenColors(PicDrawManager &pdm, const PicComponent &pic, PicScreen screen, int &count)
+	{
+		if (screen == PicScreen::Visual)
+		{
+			if (pdm.IsVGA())
+			{
+				count = 256;
+				return pdm.GetVGAPalette();
+			}
+			count = ARRAYSIZE(g_egaColors);
+			return g_egaColors;
+		}
+		if (pic.Traits->ContinuousPriority)
+		{
+			count = ARRAYSIZE(g_continuousPriorityColors);
+			return g_continuousPriorityColors;
+		}
+		count = ARRAYSIZE(g_egaColors);
+		return g_egaColors;
+	}
+}
+
+PicRenderService::PicRenderService(const PicRenderOptions &options) : _options(options) {}
+
+vector<PicRenderResult> PicRenderService::Render(const vector<PicRenderJob> &jobs, const string &outputFolderIn)
+{
+	// Forward slashes work everywhere.
+	string outputFolder = outputFolderIn;
+	if (!outputFolder.empty() && (outputFolder.back() != '\\') && (outputFolder.back() != '/'))
+	{
+		outputFolder += "/";
+	}
+
+	vector<PicRenderResult> results(jobs.size());
+	if (!jobs.empty())
+	{
+		size_t workerCount = _options.ThreadCount ? _options.ThreadCount : ThreadPool::GetDefaultThreadCount();
+		workerCount = (min)(workerCount, jobs.size());
+
+		atomic<size_t> nextJob(0);
+		ThreadPool pool(workerCount);
+		vector<future<void>> workers;
+		for (size_t i = 0; i < workerCount; i++)
+		{
+			workers.push_back(pool.Submit([this, &jobs, &results, &nextJob, &outputFolder]()
+			{
+				PicDrawManager pdm;
+				pdm.SetCheckpointBudget(0);	// We never seek
+				for (size_t job = nextJob++; job < jobs.size(); job = nextJob++)
+				{
+					// Each result is only touched by one worker.
+					results[job] = _Render(pdm, jobs[job], outputFolder);
+				}
+			}));
+		}
+		for (auto &worker : workers)
+		{
+			worker.get();
+		}
+	}
+
+	ofstream report(outputFolder + TimingReportFilename, ios::out | ios::trunc);
+	WriteTimingReport(results, report);
+	return results;
+}
+
+PicRenderResult PicRenderService::_Render(PicDrawManager &pdm, const PicRenderJob &job, const string &outputFolder)
+{
+	PicRenderResult result = { job.Name, chrono::microseconds(0), chrono::microseconds(0) };
+	try
+	{
+		auto start = chrono::steady_clock::now();
+		pdm.SetPic(job.Pic, job.Palette, false);
+		pdm.RefreshAllScreens(_options.Screens, PicPositionFlags::Final);
+		auto rendered = chrono::steady_clock::now();
+		result.RenderTime = chrono::duration_cast<chrono::microseconds>(rendered - start);
+
+		vector<uint8_t> encoded;
+		for (const ScreenOutput &output : c_screenOutputs)
+		{
+			if (IsFlagSet(_options.Screens, PicScreenToFlags(output.Screen)))
+			{
+				size16 size = job.Pic->Size;
+				const uint8_t *bits = pdm.GetPicBits(output.Screen, PicPosition::Final, size);
+				string filename = outputFolder + job.Name + output.Suffix;
+				if (_options.Format == PicRenderFormat::Png)
+				{
+					int colorCount;
+					const RGBQUAD *colors = _GetScreenColors(pdm, *job.Pic, output.Screen, colorCount);
+					EncodePng8(bits, size.cx, size.cy, true, colors, colorCount, encoded);
+					_WriteFile(filename + ".png", &encoded[0], encoded.size());
+				}
+				else
+				{
+					// Our screens are bottom-up.
+					encoded.resize(size.cx * size.cy);
+					for (int y = 0; y < size.cy; y++)
+					{
+						memcpy(&encoded[y * size.cx], bits + (size.cy - 1 - y) * size.cx, size.cx);
+					}
+					_WriteFile(filename + ".raw", &encoded[0], encoded.size());
+				}
+			}
+		}
+		result.WriteTime = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - rendered);
+	}
+	catch (std::exception &e)
+	{
+		result.Error = e.what();
+	}
+	return result;
+}
+
+void PicRenderService::WriteTimingReport(const vector<PicRenderResult> &results, ostream &out)
+{
+	out << "name,render_us,write_us,error\n";
+	chrono::microseconds totalRender(0);
+	chrono::microseconds totalWrite(0);
+	for (const PicRenderResult &result : results)
+	{
+		out << fmt::format("{0},{1},{2},{3}\n", result.Name, result.RenderTime.count(), result.WriteTime.count(), result.Error);
+		totalRender += result.RenderTime;
+		totalWrite += result.WriteTime;
+	}
+	out << fmt::format("total,{0},{1},\n", totalRender.count(), totalWrite.count());
+}
@@ -0,0 +1,75 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#pragma once
+
+// fwd decl
+struct PicComponent;
+struct PaletteComponent;
+class PicDrawManager;
+
+enum class PicRenderFormat
+{
+	Raw,	// Just the screen's color indices, top row first, one byte per pixel.
+	Png,
+};
+
+struct PicRenderOptions
+{
+	PicRenderOptions() : Screens(PicScreenFlags::Visual | PicScreenFlags::Priority | PicScreenFlags::Control), Format(PicRenderFormat::Png), ThreadCount(0) {}
+
+	PicScreenFlags Screens;
+	PicRenderFormat Format;
+	size_t ThreadCount;		// 0 means one per hardware thread
+};
+
+struct PicRenderJob
+{
+	std::string Name;					// Output files are Name-vis, Name-pri and Name-ctl.
+	const PicComponent *Pic;
+	const PaletteComponent *Palette;	// For VGA pics. nullptr for EGA.
+};
+
+struct PicRenderResult
+{
+	std::string Name;
+	std::chrono::microseconds RenderTime;
+	std::chrono::microseconds WriteTime;
+	std::string Error;					// Empty if it worked.
+};
+
+//
+// Renders pics to files, without any UI (no HBITMAPs, no GDI). Use it to compare renders of
+// whole games.
+//
+// Each worker thread has its own PicDrawManager, so its buffers are reused from one pic to the next.
+// Workers take the next pic off a shared counter as they finish the previous one, so a few slow pics
+// don't hold everyone else up. Files are written as each pic finishes.
+//
+class PicRenderService
+{
+public:
+	PicRenderService(const PicRenderOptions &options = PicRenderOptions());
+
+	// The caller keeps the pics and palettes alive until this returns. Errors are reported per pic.
+	// Also writes the timing report to TimingReportFilename in the output folder.
+	std::vector<PicRenderResult> Render(const std::vector<PicRenderJob> &jobs, const std::string &outputFolder);
+
+	static const char TimingReportFilename[];
+	static void WriteTimingReport(const std::vector<PicRenderResult> &results, std::ostream &out);
+
+private:
+	PicRenderResult _Render(PicDrawManager &pdm, const PicRenderJob &job, const std::string &outputFolder);
+
+	PicRenderOptions _options;
+};
@@ -0,0 +1,235 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#include "stdafx.h"
+#include "PriorityComposite.h"
+#include <intrin.h>
+#include <immintrin.h>
+
+namespace
+{
+	// Tracks what the outline needs to know as we go along the row.
+	struct OutlineState
+	{
+		OutlineState() : FirstHidden(-1), LastHidden(-1), LastOpaque(-1) {}
+
+		// Bit n of the masks is for pixel base + n.
+		void Update(int base, uint32_t opaqueBits, uint32_t hiddenBits)
+		{
+			unsigned long index;
+			if (hiddenBits)
+			{
+				if (FirstHidden == -1)
+				{
+					_BitScanForward(&index, hiddenBits);
+					FirstHidden = base + (int)index;
+				}
+				_BitScanReverse(&index, hiddenBits);
+				LastHidden = base + (int)index;
+			}
+			if (opaqueBits)
+			{
+				_BitScanReverse(&index, opaqueBits);
+				LastOpaque = base + (int)index;
+			}
+		}
+
+		int FirstHidden;
+		int LastHidden;
+		int LastOpaque;
+	};
+
+	void _CompositeScalar(int x, uint8_t *display, const uint8_t *priority, uint8_t *priorityWrite, const uint8_t *image, int count,
+		uint8_t egoPriority, uint8_t transparent, bool isEGAUndithered, OutlineState *outline)
+	{
+		for (; x < count; x++)
+		{
+			uint8_t bView = image[x];
+			if (bView != transparent)
+			{
+				bool fShowing = priority ? (priority[x] <= egoPriority) : true;
+				if (fShowing)
+				{
+					if (isEGAUndithered)
+					{
+						// Duplicate the color into the other slot if undithered.
+						bView |= (bView << 4);
+					}
+					display[x] = bView;
+					if (priorityWrite)
+					{
+						priorityWrite[x] = egoPriority;
+					}
+				}
+				if (outline)
+				{
+					outline->Update(x, 1, fShowing ? 0 : 1);
+				}
+			}
+		}
+	}
+
+	// These start at x, and return the index of the first pixel not done.
+	int _CompositeSSE2(int x, uint8_t *display, const uint8_t *priority, uint8_t *priorityWrite, const uint8_t *image, int count,
+		uint8_t egoPriority, uint8_t transparent, bool isEGAUndithered, OutlineState *outline)
+	{
+		const __m128i transparentValues = _mm_set1_epi8((char)transparent);
+		const __m128i egoValues = _mm_set1_epi8((char)egoPriority);
+		const __m128i highNibbles = _mm_set1_epi8((char)0xf0);
+		const __m128i allSet = _mm_set1_epi8((char)0xff);
+		for (; x + 16 <= count; x += 16)
+		{
+			__m128i view = _mm_loadu_si128(reinterpret_cast<const __m128i*>(image + x));
+			__m128i isTransparent = _mm_cmpeq_epi8(view, transparentValues);
+			__m128i showing = allSet;
+			if (priority)
+			{
+				// pri <= ego, unsigned: min(pri, ego) == pri
+				__m128i pri = _mm_loadu_si128(reinterpret_cast<const __m128i*>(priority + x));
+				showing = _mm_cmpeq_epi8(_mm_min_epu8(pri, egoValues), pri);
+			}
+			if (outline)
+			{
+				uint32_t transparentBits = (uint32_t)_mm_movemask_epi8(isTransparent);
+				uint32_t showingBits = (uint32_t)_mm_movemask_epi8(showing);
+				outline->Update(x, ~transparentBits & 0xffff, ~(transparentBits | showingBits) & 0xffff);
+			}
+			showing = _mm_andnot_si128(isTransparent, showing);
+
+			if (isEGAUndithered)
+			{
+				// The 16-bit shift spills into the neighbouring byte, but only the low nibble, which we mask off.
+				view = _mm_or_si128(view, _mm_and_si128(_mm_slli_epi16(view, 4), highNibbles));
+			}
+			uint8_t *dest = display + x;
+			__m128i old = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_or_si128(_mm_and_si128(showing, view), _mm_andnot_si128(showing, old)));
+
+			if (priorityWrite)
+			{
+				uint8_t *destPri = priorityWrite + x;
+				old = _mm_loadu_si128(reinterpret_cast<const __m128i*>(destPri));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destPri), _mm_or_si128(_mm_and_si128(showing, egoValues), _mm_andnot_si128(showing, old)));
+			}
+		}
+		return x;
+	}
+
+	int _CompositeAVX2(int x, uint8_t *display, const uint8_t *priority, uint8_t *priorityWrite, const uint8_t *image, int count,
+		uint8_t egoPriority, uint8_t transparent, bool isEGAUndithered, OutlineState *outline)
+	{
+		const __m256i transparentValues = _mm256_set1_epi8((char)transparent);
+		const __m256i egoValues = _mm256_set1_epi8((char)egoPriority);
+		const __m256i highNibbles = _mm256_set1_epi8((char)0xf0);
+		const __m256i allSet = _mm256_set1_epi8((char)0xff);
+		for (; x + 32 <= count; x += 32)
+		{
+			__m256i view = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(image + x));
+			__m256i isTransparent = _mm256_cmpeq_epi8(view, transparentValues);
+			__m256i showing = allSet;
+			if (priority)
+			{
+				__m256i pri = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(priority + x));
+				showing = _mm256_cmpeq_epi8(_mm256_min_epu8(pri, egoValues), pri);
+			}
+			if (outline)
+			{
+				uint32_t transparentBits = (uint32_t)_mm256_movemask_epi8(isTransparent);
+				uint32_t showingBits = (uint32_t)_mm256_movemask_epi8(showing);
+				outline->Update(x, ~transparentBits, ~(transparentBits | showingBits));
+			}
+			showing = _mm256_andnot_si256(isTransparent, showing);
+
+			if (isEGAUndithered)
+			{
+				view = _mm256_or_si256(view, _mm256_and_si256(_mm256_slli_epi16(view, 4), highNibbles));
+			}
+			uint8_t *dest = display + x;
+			__m256i old = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dest));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), _mm256_blendv_epi8(old, view, showing));
+
+			if (priorityWrite)
+			{
+				uint8_t *destPri = priorityWrite + x;
+				old = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(destPri));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(destPri), _mm256_blendv_epi8(old, egoValues, showing));
+			}
+		}
+		// Avoid the penalty for mixing AVX and SSE code.
+		_mm256_zeroupper();
+		return x;
+	}
+
+	CompositeKernel _DetectBestKernel()
+	{
+		int info[4];
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+		__cpuid(info, 1);
+		bool sse2 = (info[3] & (1 << 26)) != 0;
+		bool osSavesAVX = false;
+		if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)))		// OSXSAVE and AVX
+		{
+			// The OS needs to save the xmm and ymm registers on a context switch.
+			osSavesAVX = (_xgetbv(0) & 0x6) == 0x6;
+		}
+		if (osSavesAVX && (maxLeaf >= 7))
+		{
+			__cpuidex(info, 7, 0);
+			if (info[1] & (1 << 5))
+			{
+				return CompositeKernel::AVX2;
+			}
+		}
+		return sse2 ? CompositeKernel::SSE2 : CompositeKernel::Scalar;
+	}
+}
+
+CompositeKernel GetBestCompositeKernel()
+{
+	static const CompositeKernel best = _DetectBestKernel();
+	return best;
+}
+
+void CompositeRowWithPriority(CompositeKernel kernel, uint8_t *display, const uint8_t *priority, uint8_t *priorityWrite, const uint8_t *image, int count,
+	uint8_t egoPriority, uint8_t transparent, bool isEGAUndithered, int *firstHidden, int *lastHidden)
+{
+	if (kernel == CompositeKernel::Best)
+	{
+		kernel = GetBestCompositeKernel();
+	}
+
+	OutlineState outlineState;
+	OutlineState *outline = (firstHidden || lastHidden) ? &outlineState : nullptr;
+
+	// The wider kernels leave the remainder of the row to the narrower ones.
+	int x = 0;
+	if (kernel == CompositeKernel::AVX2)
+	{
+		x = _CompositeAVX2(x, display, priority, priorityWrite, image, count, egoPriority, transparent, isEGAUndithered, outline);
+	}
+	if ((kernel == CompositeKernel::AVX2) || (kernel == CompositeKernel::SSE2))
+	{
+		x = _CompositeSSE2(x, display, priority, priorityWrite, image, count, egoPriority, transparent, isEGAUndithered, outline);
+	}
+	_CompositeScalar(x, display, priority, priorityWrite, image, count, egoPriority, transparent, isEGAUndithered, outline);
+
+	if (firstHidden)
+	{
+		*firstHidden = outlineState.FirstHidden;
+	}
+	if (lastHidden)
+	{
+		*lastHidden = ((outlineState.LastHidden != -1) && (outlineState.LastHidden == outlineState.LastOpaque)) ? outlineState.LastHidden : -1;
+	}
+}
@@ -0,0 +1,38 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#pragma once
+
+enum class CompositeKernel
+{
+	Scalar,
+	SSE2,		// 16 pixels at a time
+	AVX2,		// 32 pixels at a time
+	Best,		// The fastest one this CPU supports
+};
+
+// Checks the CPU once, and remembers the answer.
+CompositeKernel GetBestCompositeKernel();
+
+//
+// Composites one row of a cel (image) over one row of a pic (display), for views drawn with priority.
+// A pixel is copied if it isn't the transparent color, and the pic's priority (if priority isn't nullptr)
+// is no greater than egoPriority. If priorityWrite isn't nullptr, egoPriority is written there for each
+// copied pixel. priorityWrite may be the same buffer as priority.
+//
+// If firstHidden and lastHidden are supplied, they receive the index of the first non-transparent
+// pixel that was hidden by priority, and the index of the last non-transparent pixel if it was hidden
+// (-1 in either case otherwise). These are used to draw the outline.
+//
+void CompositeRowWithPriority(CompositeKernel kernel, uint8_t *display, const uint8_t *priority, uint8_t *priorityWrite, const uint8_t *image, int count,
+	uint8_t egoPriority, uint8_t transparent, bool isEGAUndithered, int *firstHidden = nullptr, int *lastHidden = nullptr);
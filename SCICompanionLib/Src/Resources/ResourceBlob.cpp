@@ -234,6 +234,67 @@ DecompressionAlgorithm VersionAndCompressionNumberToAlgorithm(SCIVersion version
 	return DecompressionAlgorithm::Unknown;
 }
 
+uint16_t CompressResourceData(const SCIVersion &version, const uint8_t *data, uint32_t length, std::vector<uint8_t> &compressed, int effort)
+{
+	uint16_t bestMethod = 0;
+	compressed.clear();
+	// SCI0, SCI1 and SCI1.1 headers store 16 bit sizes (and the LZW/Huffman decoders use 16 bit counters), with SCI0
+	// also counting 4 bytes of the header in the compressed size.
+	if (length > (std::numeric_limits<uint16_t>::max)())
+	{
+		return 0;
+	}
+	size_t bestSize = (std::min<size_t>)(length, (std::numeric_limits<uint16_t>::max)() - 4);
+	std::vector<uint8_t> candidate;
+	auto consider = [&](uint16_t method)
+	{
+		if (candidate.size() < bestSize)
+		{
+			bestSize = candidate.size();
+			bestMethod = method;
+			compressed.swap(candidate);
+		}
+	};
+
+	if ((version.PackageFormat == ResourcePackageFormat::SCI0) || (version.PackageFormat == ResourcePackageFormat::SCI1))
+	{
+		for (uint16_t method = 1; method <= 2; method++)
+		{
+			switch (VersionAndCompressionNumberToAlgorithm(version, method))
+			{
+				case DecompressionAlgorithm::LZW:
+					compressLZW(data, (int)length, candidate);
+					break;
+				case DecompressionAlgorithm::Huffman:
+					compressHuffman(data, (int)length, candidate);
+					break;
+				case DecompressionAlgorithm::LZW1:
+					compressLZW_1(data, (int)length, candidate);
+					break;
+				default:
+					continue;
+			}
+			consider(method);
+		}
+	}
+	else if (version.PackageFormat == ResourcePackageFormat::SCI11)
+	{
+		// SCI1.1 interpreters only do DCL (and the LZW variants, which never do better). Text heavy resources
+		// sometimes come out smaller in ASCII mode.
+		for (bool asciiMode : { false, true })
+		{
+			compressDCL(data, length, candidate, asciiMode, effort);
+			consider(18);
+		}
+	}
+
+	if (bestMethod == 0)
+	{
+		compressed.clear();
+	}
+	return bestMethod;
+}
+
 void ResourceBlob::SetKeyValue(BlobKey key, uint32_t value)
 {
 	header.PropertyBag[key] = value;
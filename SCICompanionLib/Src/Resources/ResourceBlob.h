@@ -108,6 +108,8 @@ struct LAYOUT_SCI0
 	uint16_t iType : 5;		   // (0 to 9) e.g. PIC == 1
 	DWORD iOffset : 26;	   // Offset within the file resource.iPackageNumber
 	DWORD iPackageNumber : 6; // Specifies which resource.xxx to use.
+
+	static const uint32_t MaxOffset = 0x3ffffff;
 };
 
 
@@ -117,6 +119,8 @@ struct LAYOUT_SCI1
 	uint16_t iType : 5;		   // (0 to 9) e.g. PIC == 1
 	DWORD iOffset : 28;	   // Offset within the file resource.iPackageNumber
 	DWORD iPackageNumber : 4; // Specifies which resource.xxx to use.
+
+	static const uint32_t MaxOffset = 0xfffffff;
 };
 
 // resource.map consists of an array of these structures, terminated by a sequence where all bits are set to on.
@@ -204,6 +208,8 @@ struct RESOURCEMAPENTRY_SCI1
 
 	static void EnsureResourceAlignment(sci::ostream &volumeStream) {}
 	static void EnsureResourceAlignment(uint32_t &offset) {}
+
+	static const uint32_t MaxOffset = 0xfffffff;
 };
 
 // resource.map contains sorted arrays of these structures, grouped by resource type.  The length of the arrays
@@ -246,10 +252,22 @@ struct RESOURCEMAPENTRY_SCI1_1
 			offset++;
 		}
 	}
+
+	// 24 bits of WORD offset
+	static const uint32_t MaxOffset = 0xffffff << 1;
 };
 
 bool DoesPackageFormatIncludeHeaderInCompressedSize(SCIVersion version);
 
+enum class DecompressionAlgorithm;
+DecompressionAlgorithm VersionAndCompressionNumberToAlgorithm(SCIVersion version, int compressionNumber);
+
+// Tries each compression method the version's interpreter understands, and returns the one that makes the data
+// smallest (with the result in compressed). Returns 0 if none of them are any smaller than the data itself.
+// effort (1 to 9) trades speed for size, for the methods that support it (DCL).
+const int DefaultCompressionEffort = 5;
+uint16_t CompressResourceData(const SCIVersion &version, const uint8_t *data, uint32_t length, std::vector<uint8_t> &compressed, int effort = DefaultCompressionEffort);
+
 // header for each entry in resource.xxx
 template<typename _TDataSizeSize, uint8_t TypeAdornment>
 struct RESOURCEHEADERBASE
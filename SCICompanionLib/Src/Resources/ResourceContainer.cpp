@@ -15,6 +15,7 @@
 #include "ResourceContainer.h"
 #include "ResourceMap.h"
 #include "ResourceBlob.h"
+#include "GameIniCache.h"
 
 using namespace std;
 
@@ -44,9 +45,7 @@ bool ResourceContainer::_PassesFilter(ResourceType type, int resourceNumber, uin
 	bool pass = (ResourceTypeFlags::None != (_resourceTypes & ResourceTypeToFlag(type)));
 	if (pass && (ResourceEnumFlags::None != (_resourceEnumFlags & ResourceEnumFlags::MostRecentOnly)))
 	{
-		// Generate an index consisting of type and number
-		uint32_t indexTemp = ((uint32_t)type) + (resourceNumber << 16);
-		uint64_t index = indexTemp + ((uint64_t)base36Number << 32);
+		uint64_t index = GetResourceKey(type, resourceNumber, base36Number);
 		pass = (_trackResources.find(index) == _trackResources.end());
 		if (pass)
 		{
@@ -105,21 +104,16 @@ bool operator!=(const IteratorStatePrivate &one, const IteratorStatePrivate &two
 	return !(one == two);
 }
 
-sci::istream ResourceContainer::ResourceIterator::_GetResourceHeaderAndPackage(ResourceHeaderAgnostic &rh) const
+sci::istream GetResourceHeaderAndPackage(ResourceSource &source, const ResourceMapEntryAgnostic &mapEntry, ResourceHeaderAgnostic &rh)
 {
-	if (_atEnd)
-	{
-		throw std::exception("invalid iterator!");
-	}
-
 	sci::istream temp;
 	try
 	{
-		temp = (*_container->_mapAndVolumes)[_state.mapIndex]->GetHeaderAndPositionedStream(_currentEntry, rh);
+		temp = source.GetHeaderAndPositionedStream(mapEntry, rh);
 	}
 	catch (std::exception)
 	{
-		rh.Type = _currentEntry.Type;
+		rh.Type = mapEntry.Type;
 		rh.cbCompressed = 0;
 		rh.cbDecompressed = 0;
 		rh.CompressionMethod = 0;
@@ -129,19 +123,100 @@ sci::istream ResourceContainer::ResourceIterator::_GetResourceHeaderAndPackage(R
 
 	// By setting these to those in the resource map (instead of the header), we can ensure that the ResourceBlob matches
 	// the resource map information. This ensures that we can delete resources in the case of a corrupt resource map/package.
-	rh.Number = _currentEntry.Number;
-	rh.PackageHint = _currentEntry.PackageNumber;
+	rh.Number = mapEntry.Number;
+	rh.PackageHint = mapEntry.PackageNumber;
 
 	return temp;
 }
 
+void GetResourceHeaderOnly(ResourceSource &source, const ResourceMapEntryAgnostic &mapEntry, ResourceHeaderAgnostic &rh)
+{
+	try
+	{
+		source.ReadHeader(mapEntry, rh);
+	}
+	catch (std::exception)
+	{
+		rh.Type = mapEntry.Type;
+		rh.cbCompressed = 0;
+		rh.cbDecompressed = 0;
+		rh.CompressionMethod = 0;
+		rh.Version = sciVersion0;
+		rh.SourceFlags = ResourceSourceFlags::ResourceMap;
+	}
+	rh.Number = mapEntry.Number;
+	rh.PackageHint = mapEntry.PackageNumber;
+}
+
+std::unique_ptr<ResourceBlob> CreateResourceBlobFromSource(ResourceSource &source, const ResourceMapEntryAgnostic &mapEntry, const std::string &gameFolder, ResourceTypeFlags types, ResourceEnumFlags enumFlags, bool delayDecompression, const GameIniTable *iniTable)
+{
+	ResourceHeaderAgnostic rh;
+	sci::istream packageByteStream = GetResourceHeaderAndPackage(source, mapEntry, rh);
+
+	// We should validate against the type here.
+	if (!IsFlagSet(types, ResourceTypeToFlag(rh.Type)))
+	{
+		throw std::exception("Corrupt resource header - mismatched types.");
+	}
+
+	std::string name;
+	if ((enumFlags & ResourceEnumFlags::NameLookups) != ResourceEnumFlags::None)
+	{
+		if (iniTable)
+		{
+			name = FigureOutResourceName(*iniTable, mapEntry.Type, mapEntry.Number, mapEntry.Base36Number);
+		}
+		else
+		{
+			name = FigureOutResourceName(GetGameIniFileName(gameFolder), mapEntry.Type, mapEntry.Number, mapEntry.Base36Number);
+		}
+	}
+
+	std::unique_ptr<ResourceBlob> blob = std::make_unique<ResourceBlob>();
+	blob->CreateFromPackageBits(
+		name,
+		rh,
+		packageByteStream,
+		delayDecompression);
+	return blob;
+}
+
+sci::istream ResourceContainer::ResourceIterator::_GetResourceHeaderAndPackage(ResourceHeaderAgnostic &rh) const
+{
+	if (_atEnd)
+	{
+		throw std::exception("invalid iterator!");
+	}
+
+	return GetResourceHeaderAndPackage(*(*_container->_mapAndVolumes)[_state.mapIndex], _currentEntry, rh);
+}
+
 ResourceHeaderAgnostic ResourceContainer::ResourceIterator::GetResourceHeader() const
 {
+	if (_atEnd)
+	{
+		throw std::exception("invalid iterator!");
+	}
+
 	ResourceHeaderAgnostic rh;
-	sci::istream packageByteStream = _GetResourceHeaderAndPackage(rh);
+	GetResourceHeaderOnly(*(*_container->_mapAndVolumes)[_state.mapIndex], _currentEntry, rh);
 	return rh;
 }
 
+ResourceHeaderRecord ResourceContainer::ResourceIterator::GetHeaderRecord() const
+{
+	ResourceHeaderAgnostic rh = GetResourceHeader();
+	ResourceHeaderRecord record;
+	record.MapEntry = _currentEntry;
+	record.Type = rh.Type;
+	record.CompressionMethod = rh.CompressionMethod;
+	record.cbCompressed = rh.cbCompressed;
+	record.cbDecompressed = rh.cbDecompressed;
+	record.Version = rh.Version;
+	record.SourceFlags = rh.SourceFlags;
+	return record;
+}
+
 ResourceContainer::ResourceIterator::reference ResourceContainer::ResourceIterator::CreateButDelayDecompression() const
 {
 	return _CreateHelper(true);
@@ -154,27 +229,24 @@ ResourceContainer::ResourceIterator::reference ResourceContainer::ResourceIterat
 
 ResourceContainer::ResourceIterator::reference ResourceContainer::ResourceIterator::_CreateHelper(bool delayDecompression) const
 {
-	ResourceHeaderAgnostic rh;
-	sci::istream packageByteStream = _GetResourceHeaderAndPackage(rh);
-
-	// We should validate against the type here.
-	if (!IsFlagSet(_container->_resourceTypes, ResourceTypeToFlag(rh.Type)))
+	if (_atEnd)
 	{
-		throw std::exception("Corrupt resource header - mismatched types.");
+		throw std::exception("invalid iterator!");
 	}
 
-	std::string name;
-	if ((_container->_resourceEnumFlags & ResourceEnumFlags::NameLookups) != ResourceEnumFlags::None)
+	if (!_container->_iniTable && IsFlagSet(_container->_resourceEnumFlags, ResourceEnumFlags::NameLookups))
 	{
-		name = FigureOutResourceName(GetGameIniFileName(_container->_gameFolder), _currentEntry.Type, _currentEntry.Number, _currentEntry.Base36Number);
+		_container->_iniTable = g_gameIniCache.GetTable(GetGameIniFileName(_container->_gameFolder));
 	}
 
-	std::unique_ptr<ResourceBlob> blob = std::make_unique<ResourceBlob>();
-	blob->CreateFromPackageBits(
-		name,
-		rh,
-		packageByteStream,
-		delayDecompression);
+	std::unique_ptr<ResourceBlob> blob = CreateResourceBlobFromSource(
+		*(*_container->_mapAndVolumes)[_state.mapIndex],
+		_currentEntry,
+		_container->_gameFolder,
+		_container->_resourceTypes,
+		_container->_resourceEnumFlags,
+		delayDecompression,
+		_container->_iniTable.get());
 
 	if (_container->_pResourceRecency)
 	{
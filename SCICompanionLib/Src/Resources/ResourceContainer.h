@@ -16,6 +16,7 @@
 #include "ResourceSources.h"
 
 class ResourceBlob;
+class GameIniTable;
 
 #define LSL6_FIX 1
 
@@ -37,6 +38,43 @@ std::string GetGameIniFileName(const std::string &gameFolder);
 
 DEFINE_ENUM_FLAGS(ResourceEnumFlags, uint16_t)
 
+// Generates an index consisting of type, number and base36 number.
+inline uint64_t GetResourceKey(ResourceType type, int resourceNumber, uint32_t base36Number)
+{
+	uint32_t indexTemp = ((uint32_t)type) + (resourceNumber << 16);
+	return indexTemp + ((uint64_t)base36Number << 32);
+}
+
+// Reads the header for a map entry from its source, and returns a stream positioned at the resource data.
+// Corrupt headers result in an empty header that still carries the map entry's number and package.
+sci::istream GetResourceHeaderAndPackage(ResourceSource &source, const ResourceMapEntryAgnostic &mapEntry, ResourceHeaderAgnostic &rh);
+// iniTable is used for name lookups, if supplied. Otherwise the game's ini file is looked up in g_gameIniCache.
+std::unique_ptr<ResourceBlob> CreateResourceBlobFromSource(ResourceSource &source, const ResourceMapEntryAgnostic &mapEntry, const std::string &gameFolder, ResourceTypeFlags types, ResourceEnumFlags enumFlags, bool delayDecompression, const GameIniTable *iniTable = nullptr);
+// Like GetResourceHeaderAndPackage, but only reads the header.
+void GetResourceHeaderOnly(ResourceSource &source, const ResourceMapEntryAgnostic &mapEntry, ResourceHeaderAgnostic &rh);
+
+//
+// What header-only enumeration produces: where a resource lives and what its header says.
+// It's a plain value, so producing one involves no allocations and no reading of resource data.
+// Corrupt resources have zero sizes.
+//
+struct ResourceHeaderRecord
+{
+	ResourceMapEntryAgnostic MapEntry;
+
+	// From the resource header:
+	ResourceType Type;
+	uint16_t CompressionMethod;
+	uint32_t cbCompressed;
+	uint32_t cbDecompressed;
+	SCIVersion Version;
+	ResourceSourceFlags SourceFlags;
+
+	int GetNumber() const { return MapEntry.Number; }
+	uint32_t GetBase36() const { return MapEntry.Base36Number; }
+	bool IsCorrupt() const { return cbDecompressed == 0; }
+};
+
 // This is used for iterating through various resources in the game (views, pics, etc...)
 class ResourceContainer
 {
@@ -85,6 +123,8 @@ public:
 
 		int GetResourceNumber();
 
+		ResourceHeaderRecord GetHeaderRecord() const;
+
 	private:
 		sci::istream _GetResourceHeaderAndPackage(ResourceHeaderAgnostic &rh) const;
 		void _GetNextEntry();
@@ -103,11 +143,50 @@ public:
 	iterator begin();
 	iterator end();
 
+	// Yields ResourceHeaderRecords instead of ResourceBlobs. Use this when the resource data isn't needed.
+	// Resources enumerated this way are not added to the recency tracker.
+	class HeaderIterator
+	{
+	public:
+		HeaderIterator(const ResourceIterator &it) : _it(it) {}
+
+		typedef const ResourceHeaderRecord *pointer;
+		typedef std::ptrdiff_t difference_type;
+		typedef std::forward_iterator_tag iterator_category;
+		typedef ResourceHeaderRecord reference;
+		typedef ResourceHeaderRecord value_type;
+
+		friend bool operator==(const HeaderIterator &one, const HeaderIterator &two) { return one._it == two._it; }
+		friend bool operator!=(const HeaderIterator &one, const HeaderIterator &two) { return one._it != two._it; }
+
+		reference operator*() const { return _it.GetHeaderRecord(); }
+		HeaderIterator& operator++() { ++_it; return *this; }
+
+	private:
+		ResourceIterator _it;
+	};
+
+	class HeaderRange
+	{
+	public:
+		HeaderRange(ResourceContainer *container) : _container(container) {}
+		HeaderIterator begin() { return HeaderIterator(_container->begin()); }
+		HeaderIterator end() { return HeaderIterator(_container->end()); }
+
+	private:
+		ResourceContainer *_container;
+	};
+
+	// e.g. for (const ResourceHeaderRecord &record : container->Headers())
+	HeaderRange Headers() { return HeaderRange(this); }
+
 private:
 	bool _PassesFilter(ResourceType type, int resourceNumber, uint32_t base36Number);
 
 	std::string _gameFolder;
 	std::set<uint64_t> _trackResources;
+	// For NameLookups. Loaded with the first resource, so all the names come from the same version of the file.
+	std::shared_ptr<const GameIniTable> _iniTable;
 
 	std::unique_ptr<ResourceSourceArray> _mapAndVolumes;
 
@@ -304,6 +383,20 @@ public:
 		// Limitations in the resource map entry may enforce WORD-alignment for resources in the volume files.
 		_TReaderMapHeader::EnsureResourceAlignment(offset);
 	}
+	static uint32_t GetMaxResourceOffset()
+	{
+		return _TReaderMapHeader::MaxOffset;
+	}
+
+	// Call when the map file has been replaced.
+	void ResetNavigation()
+	{
+		lookupPointers.clear();
+		for (int i = 0; i < ARRAYSIZE(appendedResources); i++)
+		{
+			appendedResources[i].clear();
+		}
+	}
 
 	const std::vector<RESOURCEMAPPREENTRY_SCI1> &GetLookupPointers(sci::istream &mapStream) { _InitLookupPointers(mapStream); return lookupPointers; }
 
@@ -380,4 +473,9 @@ public:
 	}
 	static void EnsureResourceAlignment(sci::ostream &volumeStream) {}
 	static void EnsureResourceAlignment(uint32_t &offset) {}
+	static uint32_t GetMaxResourceOffset()
+	{
+		return _TReaderMapHeader::MaxOffset;
+	}
+	void ResetNavigation() {}
 };
@@ -153,5 +153,8 @@ public:
 	ResourceType GetType() const { return Traits.Type; }
 
 private:
+	// Undo deltas need to look at all the components.
+	friend class ResourceUndoDelta;
+
 	std::unordered_map<std::type_index, std::unique_ptr<ResourceComponent>> components;
 };
@@ -0,0 +1,186 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#include "stdafx.h"
+#include "ResourceIndex.h"
+#include "ResourceContainer.h"
+#include "GameFolderHelper.h"
+#include "ResourceBlob.h"
+
+using namespace std;
+
+// Audio lives in its own volumes and is scoped to map contexts, so it's not indexed. Since asking for audio
+// excludes audio maps (see GameFolderHelper::Resources), we leave those out too.
+const ResourceTypeFlags IndexedTypes = ResourceTypeFlags::All & ~(ResourceTypeFlags::Audio | ResourceTypeFlags::AudioMap);
+
+// The flags that determine which sources are used. Each combination gets its own view.
+const ResourceEnumFlags SourceSelectingFlags = ResourceEnumFlags::ExcludePatchFiles | ResourceEnumFlags::ExcludePackagedFiles;
+
+// Once this many resources have been changed since building a view, it's cheaper to rebuild it
+// than to keep answering those from a full enumeration.
+const size_t MaxStaleKeys = 32;
+
+ResourceIndex::ResourceIndex() : _version(sciVersion0) {}
+
+bool ResourceIndex::_CanIndex(ResourceType type, ResourceEnumFlags enumFlags, int mapContext) const
+{
+	return (mapContext == -1) &&
+		IsFlagSet(IndexedTypes, ResourceTypeToFlag(type)) &&
+		!IsFlagSet(enumFlags, ResourceEnumFlags::IncludeCacheFiles) &&
+		!IsFlagSet(enumFlags, ResourceEnumFlags::CalculateRecency);
+}
+
+ResourceIndex::IndexView &ResourceIndex::_EnsureView(const GameFolderHelper &helper, ResourceEnumFlags enumFlags)
+{
+	if ((_gameFolder != helper.GameFolder) || (_version != helper.Version))
+	{
+		// e.g. we're being used while the SCI version is still being sniffed.
+		_views.clear();
+		_gameFolder = helper.GameFolder;
+		_version = helper.Version;
+	}
+
+	uint16_t viewKey = (uint16_t)(enumFlags & SourceSelectingFlags);
+	auto itView = _views.find(viewKey);
+	if ((itView != _views.end()) && (itView->second->StaleKeys.size() <= MaxStaleKeys))
+	{
+		return *itView->second;
+	}
+
+	std::unique_ptr<IndexView> view = make_unique<IndexView>();
+	view->Sources = helper.CreateResourceSources(IndexedTypes, enumFlags & SourceSelectingFlags, -1);
+	for (size_t sourceIndex = 0; sourceIndex < view->Sources->size(); sourceIndex++)
+	{
+		IteratorState state;
+		ResourceMapEntryAgnostic entry;
+		while ((*view->Sources)[sourceIndex]->ReadNextEntry(IndexedTypes, state, entry))
+		{
+			if (IsFlagSet(IndexedTypes, ResourceTypeToFlag(entry.Type)))
+			{
+				// Sources are in priority order, so the first one we encounter is the most recent. emplace
+				// won't replace existing ones.
+				view->Entries.emplace(GetResourceKey(entry.Type, entry.Number, entry.Base36Number), ResourceIndexEntry{ sourceIndex, entry });
+			}
+		}
+	}
+
+	std::unique_ptr<IndexView> &slot = _views[viewKey];
+	slot = move(view);
+	return *slot;
+}
+
+const ResourceIndexEntry *ResourceIndex::_Lookup(IndexView &view, ResourceType type, int number, uint32_t base36Number, bool &isStale)
+{
+	uint64_t key = GetResourceKey(type, number, base36Number);
+	isStale = (view.StaleKeys.find(key) != view.StaleKeys.end());
+	if (!isStale)
+	{
+		auto it = view.Entries.find(key);
+		if (it != view.Entries.end())
+		{
+			return &it->second;
+		}
+	}
+	return nullptr;
+}
+
+bool ResourceIndex::TryMostRecentResource(const GameFolderHelper &helper, ResourceType type, int number, ResourceEnumFlags enumFlags, uint32_t base36Number, int mapContext, std::unique_ptr<ResourceBlob> &blobOut)
+{
+	if (IsFlagSet(enumFlags, ResourceEnumFlags::AddInDefaultEnumFlags))
+	{
+		enumFlags |= helper.GetDefaultEnumFlags();
+	}
+
+	if (!_CanIndex(type, enumFlags, mapContext))
+	{
+		return false;
+	}
+
+	lock_guard<mutex> lock(_mutex);
+	IndexView &view = _EnsureView(helper, enumFlags);
+	bool isStale;
+	const ResourceIndexEntry *indexEntry = _Lookup(view, type, number, base36Number, isStale);
+	if (isStale)
+	{
+		return false;
+	}
+
+	if (indexEntry)
+	{
+		// Reading from the source is done under the lock, since the sources lazily open their volumes.
+		// The blob gets its own copy of the data though.
+		blobOut = CreateResourceBlobFromSource(*(*view.Sources)[indexEntry->SourceIndex], indexEntry->MapEntry, helper.GameFolder, ResourceTypeToFlag(type), enumFlags, false);
+	}
+	return true;
+}
+
+bool ResourceIndex::TryDoesResourceExist(const GameFolderHelper &helper, ResourceType type, int number, ResourceEnumFlags enumFlags, std::string *retrieveName, bool &existsOut)
+{
+	if (!_CanIndex(type, enumFlags, -1))
+	{
+		return false;
+	}
+
+	lock_guard<mutex> lock(_mutex);
+	IndexView &view = _EnsureView(helper, enumFlags);
+	bool isStale;
+	const ResourceIndexEntry *indexEntry = _Lookup(view, type, number, NoBase36, isStale);
+	if (isStale)
+	{
+		return false;
+	}
+
+	existsOut = (indexEntry != nullptr);
+	if (existsOut && retrieveName)
+	{
+		*retrieveName = FigureOutResourceName(GetGameIniFileName(helper.GameFolder), type, number, NoBase36);
+	}
+	return true;
+}
+
+void ResourceIndex::Invalidate()
+{
+	lock_guard<mutex> lock(_mutex);
+	_views.clear();
+}
+
+void ResourceIndex::_MarkStale(ResourceType type, int number, uint32_t base36Number)
+{
+	lock_guard<mutex> lock(_mutex);
+	uint64_t key = GetResourceKey(type, number, base36Number);
+	for (auto &view : _views)
+	{
+		view.second->StaleKeys.insert(key);
+	}
+}
+
+void ResourceIndex::OnResourceAdded(const ResourceBlob *pData, AppendBehavior appendBehavior)
+{
+	_MarkStale(pData->GetType(), pData->GetNumber(), pData->GetBase36());
+}
+
+void ResourceIndex::OnResourceDeleted(const ResourceBlob *pData)
+{
+	_MarkStale(pData->GetType(), pData->GetNumber(), pData->GetBase36());
+}
+
+void ResourceIndex::OnResourceMapReloaded(bool isInitialLoad)
+{
+	Invalidate();
+}
+
+void ResourceIndex::OnResourceTypeReloaded(ResourceType iType)
+{
+	// This happens after a batch of deferred appends, so we don't know which ones changed.
+	Invalidate();
+}
@@ -0,0 +1,85 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#pragma once
+
+#include "ResourceMapEvents.h"
+#include "ResourceSources.h"
+
+class GameFolderHelper;
+class ResourceBlob;
+enum class ResourceEnumFlags : uint16_t;
+
+//
+// Where the most recent version of a resource lives: the source it came from (index into
+// the retained ResourceSourceArray) and its map entry (package and offset).
+//
+struct ResourceIndexEntry
+{
+	size_t SourceIndex;
+	ResourceMapEntryAgnostic MapEntry;
+};
+
+//
+// A persistent per-game index of the "most recent" resources, so that looking up a single resource
+// by type and number is a hash probe instead of a walk over every map and patch file.
+//
+// The index keeps the sources it was built from alive, so resource data can be read from them
+// without reopening the map and volumes. Those sources are snapshots of the files on disk, so
+// resources that we add or delete are marked stale (and answered by a regular enumeration) until
+// the index is rebuilt.
+//
+// Audio resources and map contexts are not indexed - callers fall back to enumerating for those.
+//
+class ResourceIndex : public IResourceMapEvents
+{
+public:
+	ResourceIndex();
+	ResourceIndex(const ResourceIndex &src) = delete;
+	ResourceIndex &operator=(const ResourceIndex &src) = delete;
+
+	// These return false if the index can't answer the query, in which case the caller needs to enumerate.
+	bool TryMostRecentResource(const GameFolderHelper &helper, ResourceType type, int number, ResourceEnumFlags enumFlags, uint32_t base36Number, int mapContext, std::unique_ptr<ResourceBlob> &blobOut);
+	bool TryDoesResourceExist(const GameFolderHelper &helper, ResourceType type, int number, ResourceEnumFlags enumFlags, std::string *retrieveName, bool &existsOut);
+
+	void Invalidate();
+
+	// IResourceMapEvents
+	void OnResourceAdded(const ResourceBlob *pData, AppendBehavior appendBehavior) override;
+	void OnResourceDeleted(const ResourceBlob *pData) override;
+	void OnResourceMapReloaded(bool isInitialLoad) override;
+	void OnResourceTypeReloaded(ResourceType iType) override;
+	void OnImagesInvalidated() override {}
+
+private:
+	struct IndexView
+	{
+		std::unique_ptr<ResourceSourceArray> Sources;
+		std::unordered_map<uint64_t, ResourceIndexEntry> Entries;
+		std::unordered_set<uint64_t> StaleKeys;
+	};
+
+	bool _CanIndex(ResourceType type, ResourceEnumFlags enumFlags, int mapContext) const;
+	IndexView &_EnsureView(const GameFolderHelper &helper, ResourceEnumFlags enumFlags);
+	const ResourceIndexEntry *_Lookup(IndexView &view, ResourceType type, int number, uint32_t base36Number, bool &isStale);
+	void _MarkStale(ResourceType type, int number, uint32_t base36Number);
+
+	std::mutex _mutex;
+
+	// What the views were built for. If the helper that queries us differs, we start over.
+	std::string _gameFolder;
+	SCIVersion _version;
+
+	// Keyed by the source-selecting ResourceEnumFlags
+	std::unordered_map<uint16_t, std::unique_ptr<IndexView>> _views;
+};
@@ -46,6 +46,9 @@
 #include "ResourceBlob.h"
 #include "DependencyTracker.h"
 #include "VersionDetectionHelper.h"
+#include "ResourceIndex.h"
+#include "GameIniCache.h"
+#include "MappedFile.h"
 
 using namespace std;
 
@@ -164,6 +167,9 @@ ResourceType ResourceFlagToType(ResourceTypeFlags dwFlags)
 
 HRESULT RebuildResources(const GameFolderHelper &helper, SCIVersion version, BOOL fShowUI, ResourceSaveLocation saveLocation, std::map<ResourceType, RebuildStats> &stats)
 {
+	RebuildOptions options;
+	options.Compression = helper.GetCompressResources() ? RebuildCompression::Best : RebuildCompression::Preserve;
+	helper.ReleaseResourceIndex();
 	try
 	{
 		// Do the audio stuff first, because it will end up adding new audio maps to the game's resources
@@ -171,7 +177,7 @@ HRESULT RebuildResources(const GameFolderHelper &helper, SCIVersion version, BOO
 		if (version.AudioVolumeName != AudioVolumeName::None)
 		{
 			std::unique_ptr<ResourceSource> resourceSource = CreateResourceSource(ResourceTypeFlags::All, helper, ResourceSourceFlags::AudioCache);
-			resourceSource->RebuildResources(true, *resourceSource, stats);
+			resourceSource->RebuildResources(true, *resourceSource, options, stats);
 		}
 
 		// Enumerate resources and write the ones we have not already encountered.
@@ -184,13 +190,13 @@ HRESULT RebuildResources(const GameFolderHelper &helper, SCIVersion version, BOO
 			patchFileSource = CreateResourceSource(ResourceTypeFlags::All, helper, ResourceSourceFlags::PatchFile);
 			theActualSource = patchFileSource.get();
 		}
-		resourceSource->RebuildResources(true, *theActualSource, stats);
+		resourceSource->RebuildResources(true, *theActualSource, options, stats);
 
 		if (version.MessageMapSource != MessageMapSource::Included)
 		{
 			ResourceSourceFlags sourceFlags = (version.MessageMapSource == MessageMapSource::MessageMap) ? ResourceSourceFlags::MessageMap : ResourceSourceFlags::AltMap;
 			std::unique_ptr<ResourceSource> messageSource = CreateResourceSource(ResourceTypeFlags::All, helper, ResourceSourceFlags::MessageMap);
-			messageSource->RebuildResources(true, *messageSource, stats);
+			messageSource->RebuildResources(true, *messageSource, options, stats);
 		}
 	}
 	catch (std::exception &e)
@@ -216,10 +222,18 @@ CResourceMap::CResourceMap(ISCIAppServices *appServices, ResourceRecency *resour
 	_deferredResources.reserve(300);			// So we don't need to resize much it when adding
 	_emptyPalette = std::make_unique<PaletteComponent>();
 	memset(_emptyPalette->Colors, 0, sizeof(_emptyPalette->Colors));
+
+	// The index needs to hear about resource changes before anyone else, since they may turn around and look up resources.
+	_resourceIndex = std::make_shared<ResourceIndex>();
+	_gameFolderHelper.SetResourceIndex(_resourceIndex);
+	AddSync(_resourceIndex.get());
 }
 
 CResourceMap::~CResourceMap()
 {
+	RemoveSync(_resourceIndex.get());
+	// Let go of this game's files.
+	g_mappedFileCache.Clear();
 	assert(_syncs.empty()); // They should remove themselves.
 	assert(_cDeferAppend == 0);
 }
@@ -404,8 +418,9 @@ void CResourceMap::RepackageAudio(bool force)
 	if (GetSCIVersion().AudioVolumeName != AudioVolumeName::None)
 	{
 		std::map<ResourceType, RebuildStats> stats;
+		Helper().ReleaseResourceIndex();
 		std::unique_ptr<ResourceSource> resourceSource = CreateResourceSource(ResourceTypeFlags::All, Helper(), ResourceSourceFlags::AudioCache);
-		resourceSource->RebuildResources(force, *resourceSource, stats);
+		resourceSource->RebuildResources(force, *resourceSource, RebuildOptions(), stats);
 	}
 }
 
@@ -738,17 +753,7 @@ void CResourceMap::DeleteResource(const ResourceBlob *pData)
 //
 std::string GetIniString(const std::string &iniFileName, PCTSTR pszSectionName, const std::string &keyName, PCSTR pszDefault)
 {
-	std::string strRet;
-	char sz[200];
-	if (GetPrivateProfileString(pszSectionName, keyName.c_str(), nullptr, sz, (DWORD)ARRAYSIZE(sz), iniFileName.c_str()))
-	{
-		strRet = sz;
-	}
-	else
-	{
-		strRet = pszDefault;
-	}
-	return strRet;
+	return g_gameIniCache.GetString(iniFileName, pszSectionName, keyName, pszDefault);
 }
 
 std::string CResourceMap::GetGameFolder() const
@@ -925,16 +930,19 @@ void CResourceMap::SetVersion(const SCIVersion &version)
 	_gameFolderHelper.Version = version;
 }
 
-//
-// Perf: we're opening and closing the file each time.  We could do this once.
-//
 std::string FigureOutResourceName(const std::string &iniFileName, ResourceType type, int iNumber, uint32_t base36Number)
+{
+	return FigureOutResourceName(*g_gameIniCache.GetTable(iniFileName), type, iNumber, base36Number);
+}
+
+// Use this overload when looking up many names, so the ini file is only checked once.
+std::string FigureOutResourceName(const GameIniTable &iniTable, ResourceType type, int iNumber, uint32_t base36Number)
 {
 	std::string name;
 	if ((size_t)type < ARRAYSIZE(g_resourceInfo))
 	{
 		std::string keyName = default_reskey(iNumber, base36Number);
-		name = GetIniString(iniFileName, GetResourceInfo(type).pszTitleDefault, keyName, keyName.c_str());
+		name = iniTable.GetString(GetResourceInfo(type).pszTitleDefault, keyName, keyName.c_str());
 	}
 	return name;
 }
@@ -1259,6 +1267,7 @@ RunLogic &CResourceMap::GetRunLogic()
 //
 void CResourceMap::SetGameFolder(const string &gameFolder)
 {
+	g_mappedFileCache.Clear();
 	_runLogic->SetGameFolder(gameFolder);
 	_gameFolderHelper.GameFolder = gameFolder;
 	_talkerToView = TalkerToViewMap(Helper().GetLipSyncFolder());
@@ -34,6 +34,7 @@ class ResourceRecency;
 class ResourceEntity;
 class GlobalCompiledScriptLookups;
 class IResourceMapEvents;
+class ResourceIndex;
 enum class ResourceSaveLocation : uint16_t;
 
 //
@@ -172,6 +173,7 @@ private:
 	std::vector<ResourceBlob> _deferredResources;
 
 	GameFolderHelper _gameFolderHelper;
+	std::shared_ptr<ResourceIndex> _resourceIndex;   // Shared with _gameFolderHelper (and copies of it)
 
 	bool _skipVersionSniffOnce;					 // Skip version sniffing when loading a game the next time.
 
@@ -23,53 +23,56 @@
 #include "RemoveScriptDialog.h"
 #include "ResourceContainer.h"
 #include "AppState.h"
+#include "GameIniCache.h"
 
 template<typename _TFileDescriptor>
-std::unique_ptr<ResourceSource> _CreateResourceSource(const std::string &gameFolder, SCIVersion version, ResourceSourceFlags source)
+std::unique_ptr<ResourceSource> _CreateResourceSource(const std::string &gameFolder, SCIVersion version, ResourceSourceFlags source, bool compressAppends)
 {
 	if (version.MapFormat == ResourceMapFormat::SCI0)
 	{
-		return std::make_unique<MapAndPackageSource<SCI0MapNavigator<RESOURCEMAPENTRY_SCI0>, _TFileDescriptor>>(version, MakeResourceHeaderReadWriter<RESOURCEHEADER_SCI0>(), gameFolder);
+		return std::make_unique<MapAndPackageSource<SCI0MapNavigator<RESOURCEMAPENTRY_SCI0>, _TFileDescriptor>>(version, MakeResourceHeaderReadWriter<RESOURCEHEADER_SCI0>(), gameFolder, compressAppends);
 	}
 	else if (version.MapFormat == ResourceMapFormat::SCI0_LayoutSCI1)
 	{
-		return std::make_unique<MapAndPackageSource<SCI0MapNavigator<RESOURCEMAPENTRY_SCI0_SCI1LAYOUT>, _TFileDescriptor>>(version, MakeResourceHeaderReadWriter<RESOURCEHEADER_SCI0>(), gameFolder);
+		return std::make_unique<MapAndPackageSource<SCI0MapNavigator<RESOURCEMAPENTRY_SCI0_SCI1LAYOUT>, _TFileDescriptor>>(version, MakeResourceHeaderReadWriter<RESOURCEHEADER_SCI0>(), gameFolder, compressAppends);
 	}
 	else if (version.MapFormat == ResourceMapFormat::SCI1)
 	{
 		if (version.PackageFormat == ResourcePackageFormat::SCI2)
 		{
-			return std::make_unique<MapAndPackageSource<SCI1MapNavigator<RESOURCEMAPENTRY_SCI1>, _TFileDescriptor>>(version, MakeResourceHeaderReadWriter<RESOURCEHEADER_SCI2>(), gameFolder);
+			return std::make_unique<MapAndPackageSource<SCI1MapNavigator<RESOURCEMAPENTRY_SCI1>, _TFileDescriptor>>(version, MakeResourceHeaderReadWriter<RESOURCEHEADER_SCI2>(), gameFolder, compressAppends);
 		}
 		else
 		{
-			return std::make_unique<MapAndPackageSource<SCI1MapNavigator<RESOURCEMAPENTRY_SCI1>, _TFileDescriptor>>(version, MakeResourceHeaderReadWriter<RESOURCEHEADER_SCI1>(), gameFolder);
+			return std::make_unique<MapAndPackageSource<SCI1MapNavigator<RESOURCEMAPENTRY_SCI1>, _TFileDescriptor>>(version, MakeResourceHeaderReadWriter<RESOURCEHEADER_SCI1>(), gameFolder, compressAppends);
 		}
 	}
 	else if (version.MapFormat == ResourceMapFormat::SCI11)
 	{
-		return std::make_unique<MapAndPackageSource<SCI1MapNavigator<RESOURCEMAPENTRY_SCI1_1>, _TFileDescriptor>>(version, MakeResourceHeaderReadWriter<RESOURCEHEADER_SCI1>(), gameFolder);
+		return std::make_unique<MapAndPackageSource<SCI1MapNavigator<RESOURCEMAPENTRY_SCI1_1>, _TFileDescriptor>>(version, MakeResourceHeaderReadWriter<RESOURCEHEADER_SCI1>(), gameFolder, compressAppends);
 	}
 	else if (version.MapFormat == ResourceMapFormat::SCI2)
 	{
-		return std::make_unique<MapAndPackageSource<SCI1MapNavigator<RESOURCEMAPENTRY_SCI1>, _TFileDescriptor>>(version, MakeResourceHeaderReadWriter<RESOURCEHEADER_SCI2_1>(), gameFolder);
+		return std::make_unique<MapAndPackageSource<SCI1MapNavigator<RESOURCEMAPENTRY_SCI1>, _TFileDescriptor>>(version, MakeResourceHeaderReadWriter<RESOURCEHEADER_SCI2_1>(), gameFolder, compressAppends);
 	}
 	return std::unique_ptr<ResourceSource>(nullptr);
 }
 
 std::unique_ptr<ResourceSource> CreateResourceSource(ResourceTypeFlags flagsHint, const GameFolderHelper &helper, ResourceSourceFlags source, ResourceSourceAccessFlags access, int mapContext)
 {
+	// Only bother looking up the game's setting if we might write to it.
+	bool compressAppends = IsFlagSet(access, ResourceSourceAccessFlags::ReadWrite) && helper.GetCompressResources();
 	if (source == ResourceSourceFlags::ResourceMap)
 	{
-		return _CreateResourceSource<FileDescriptorResourceMap>(helper.GameFolder, helper.Version, source);
+		return _CreateResourceSource<FileDescriptorResourceMap>(helper.GameFolder, helper.Version, source, compressAppends);
 	}
 	else if (source == ResourceSourceFlags::MessageMap)
 	{
-		return _CreateResourceSource<FileDescriptorMessageMap>(helper.GameFolder, helper.Version, source);
+		return _CreateResourceSource<FileDescriptorMessageMap>(helper.GameFolder, helper.Version, source, compressAppends);
 	}
 	else if (source == ResourceSourceFlags::AltMap)
 	{
-		return _CreateResourceSource<FileDescriptorAltMap>(helper.GameFolder, helper.Version, source);
+		return _CreateResourceSource<FileDescriptorAltMap>(helper.GameFolder, helper.Version, source, compressAppends);
 	}
 	else if (source == ResourceSourceFlags::PatchFile)
 	{
@@ -113,6 +116,9 @@ void DeleteResource(CResourceMap &resourceMap, const ResourceBlob &data)
 		sourcFlags = ResourceSourceFlags::AudioCache;
 	}
 
+	// Removing an entry rewrites the volume, so the index can't be holding on to it.
+	helper.ReleaseResourceIndex();
+
 	// This is the thing that changes based on version and messagemap or blah.
 	std::unique_ptr<ResourceSource> resourceSource = CreateResourceSource(ResourceTypeToFlag(data.GetType()), resourceMap.Helper(), sourcFlags, ResourceSourceAccessFlags::ReadWrite);
 	if (resourceSource)
@@ -198,6 +204,7 @@ void DeleteResource(CResourceMap &resourceMap, const ResourceBlob &data)
 				WritePrivateProfileString("Script", iniKey.c_str(), nullptr, helper.GetGameIniFileName().c_str());
 				// Second, remove from the [Language] section
 				WritePrivateProfileString("Language", scriptTitle.c_str(), nullptr, helper.GetGameIniFileName().c_str());
+				g_gameIniCache.Invalidate(helper.GetGameIniFileName());
 
 				if (dialog.AlsoDelete())
 				{
@@ -205,7 +212,8 @@ void DeleteResource(CResourceMap &resourceMap, const ResourceBlob &data)
 					std::unique_ptr<ResourceBlob> theHeapOne = resourceMap.MostRecentResource(ResourceType::Heap, data.GetNumber(), false);
 					if (theHeapOne)
 					{
-						DeleteResource(resourceMap, *theHeapOne);
+						// Go through the resource map so that listeners find out about this too.
+						resourceMap.DeleteResource(theHeapOne.get());
 					}
 
 					if (!DeleteFile(scriptId.GetFullPath().c_str()))
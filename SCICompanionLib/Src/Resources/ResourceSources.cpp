@@ -57,6 +57,66 @@ std::string FileDescriptorBase::_GetVolumeFilenameBak(int volume) const
 	return fmt::format(folderFileFormatBak, _gameFolder, fmt::format(_traits.VolumeFormat, volume));
 }
 
+uint32_t FileDescriptorBase::GetVolumeSize(int volumeNumber) const
+{
+	if (!DoesVolumeExist(volumeNumber))
+	{
+		return 0;
+	}
+	ScopedFile volume(_GetVolumeFilename(volumeNumber), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING);
+	return volume.GetLength();
+}
+
+void FileDescriptorBase::AppendToVolumesAndReplaceMap(const sci::ostream &mapStream, const std::unordered_map<int, VolumeAppend> &volumeAppends) const
+{
+	std::vector<std::pair<int, uint32_t>> appendedVolumes;
+	try
+	{
+		for (const auto &volumeAppend : volumeAppends)
+		{
+			ScopedFile volume(_GetVolumeFilename(volumeAppend.first), GENERIC_WRITE, 0, OPEN_ALWAYS);
+			if (volume.GetLength() != volumeAppend.second.Offset)
+			{
+				// The offsets in the new map entries would be wrong.
+				throw std::exception("The resource volume was modified while saving.");
+			}
+			volume.SeekToEnd();
+			// Views of the old contents are still valid, but nothing new should get them.
+			g_mappedFileCache.Invalidate(_GetVolumeFilename(volumeAppend.first));
+			appendedVolumes.emplace_back(volumeAppend.first, volumeAppend.second.Offset);
+			volume.Write(volumeAppend.second.Data.GetInternalPointer(), volumeAppend.second.Data.GetDataSize());
+			// The new map will point to this data, so it must be on disk before the map is.
+			volume.Flush();
+		}
+
+		{
+			ScopedFile holderMap(_GetMapFilenameBak(), GENERIC_WRITE, 0, CREATE_ALWAYS);
+			holderMap.Write(mapStream.GetInternalPointer(), mapStream.GetDataSize());
+			holderMap.Flush();
+		}
+
+		g_mappedFileCache.Invalidate(_GetMapFilename());
+		replacefile(_GetMapFilenameBak(), _GetMapFilename());
+	}
+	catch (std::exception)
+	{
+		// The old map is still in place, so just get rid of what we appended.
+		for (const auto &volumeAndSize : appendedVolumes)
+		{
+			try
+			{
+				ScopedFile volume(_GetVolumeFilename(volumeAndSize.first), GENERIC_WRITE, 0, OPEN_EXISTING);
+				volume.Truncate(volumeAndSize.second);
+			}
+			catch (std::exception)
+			{
+				// Not fatal, the extra data isn't referenced by anything.
+			}
+		}
+		throw;
+	}
+}
+
 bool IsResourceCompatible(const SCIVersion &usVersion, const SCIVersion &resourceVersion, ResourceType type)
 {
 	if (resourceVersion == usVersion)
@@ -96,3 +156,139 @@ bool IsResourceCompatible(const SCIVersion &version, const ResourceBlob &blob)
 {
 	return IsResourceCompatible(version, blob.GetVersion(), blob.GetType());
 }
+
+ResourceReadAhead::ResourceReadAhead(ResourceSource &source, WriteResourceHeaderFunc headerWriter, SCIVersion version, const RebuildOptions &options) :
+	_source(source),
+	_headerWriter(headerWriter),
+	_version(version),
+	_compression(options.Compression),
+	_effort(options.CompressionEffort),
+	_limit(max<size_t>(1, options.ReadAheadLimit))
+{
+	size_t threadCount = (options.ThreadCount == 0) ? ThreadPool::GetDefaultThreadCount() : options.ThreadCount;
+	if (threadCount > 1)
+	{
+		_pool = make_unique<ThreadPool>(threadCount);
+	}
+}
+
+bool ResourceReadAhead::_ReadCompressedChunk(ResourceSource &source, WriteResourceHeaderFunc headerWriter, SCIVersion version, int effort, RebuildChunk &chunk)
+{
+	ResourceHeaderAgnostic header;
+	sci::istream readStream = source.GetHeaderAndPositionedStream(chunk.Entry, header);
+	ResourceBlob blob;
+	blob.CreateFromPackageBits("", header, readStream);
+	if (IsFlagSet(blob.GetStatusFlags(), ResourceLoadStatusFlags::DecompressionFailed | ResourceLoadStatusFlags::Corrupted))
+	{
+		// Leave it as it is.
+		return false;
+	}
+
+	const uint8_t *data = blob.GetData();
+	uint32_t length = blob.GetDecompressedLength();
+	vector<uint8_t> compressed;
+	header.Base36Number = chunk.Entry.Base36Number;
+	header.Number = chunk.Entry.Number;
+	header.PackageHint = chunk.Entry.PackageNumber;
+	header.Type = chunk.Entry.Type;
+	header.Version = version;
+	header.CompressionMethod = CompressResourceData(version, data, length, compressed, effort);
+	header.cbDecompressed = length;
+	if (header.CompressionMethod != 0)
+	{
+		data = &compressed[0];
+		length = (uint32_t)compressed.size();
+	}
+	header.cbCompressed = length;
+
+	unique_ptr<sci::ostream> chunkData = make_unique<sci::ostream>();
+	(*headerWriter)(*chunkData, header);
+	chunkData->WriteBytes(data, (int)length);
+	chunk.Data = move(chunkData);
+	chunk.ResourceSize = length;
+	return true;
+}
+
+RebuildChunk ResourceReadAhead::_ReadChunk(ResourceSource &source, WriteResourceHeaderFunc headerWriter, SCIVersion version, RebuildCompression compression, int effort, const ResourceMapEntryAgnostic &entry)
+{
+	RebuildChunk chunk;
+	chunk.Entry = entry;
+	chunk.ResourceSize = 0;
+
+	if (compression == RebuildCompression::Best)
+	{
+		try
+		{
+			if (_ReadCompressedChunk(source, headerWriter, version, effort, chunk))
+			{
+				return chunk;
+			}
+		}
+		catch (std::exception)
+		{
+			// Fall back to copying it as is.
+		}
+	}
+
+	// We don't really care about the headerEntry. All we need to know is the position and size of the data
+	// we want to copy. The position is given by the mapentry offset, and the size is the cbCompressed plus the
+	// header size.
+	try
+	{
+		bool includesHeader;
+		uint32_t totalResourceSize;
+		sci::istream readStream = source.GetPositionedStreamAndResourceSizeIncludingHeader(entry, totalResourceSize, includesHeader);
+
+		unique_ptr<sci::ostream> data = make_unique<sci::ostream>();
+		if (!includesHeader)
+		{
+			// This is the case for when we put patch files into the resource map.
+			ResourceHeaderAgnostic header;
+			header.cbCompressed = totalResourceSize;
+			header.cbDecompressed = totalResourceSize;
+			header.Base36Number = entry.Base36Number;
+			header.Number = entry.Number;
+			header.PackageHint = entry.PackageNumber;
+			header.Type = entry.Type;
+			header.Version = version;
+			header.CompressionMethod = 0;
+			(*headerWriter)(*data, header);
+		}
+		// else the data we're copying already includes the header.
+
+		transfer(readStream, *data, totalResourceSize);
+		chunk.Data = move(data);
+		chunk.ResourceSize = totalResourceSize;
+	}
+	catch (std::exception)
+	{
+		// Corrupt resources (e.g. zero size, or invalid map entries) shouldn't prevent us from re-building.
+	}
+	return chunk;
+}
+
+void ResourceReadAhead::Push(const ResourceMapEntryAgnostic &entry)
+{
+	ResourceSource &source = _source;
+	WriteResourceHeaderFunc headerWriter = _headerWriter;
+	SCIVersion version = _version;
+	RebuildCompression compression = _compression;
+	int effort = _effort;
+	auto read = [&source, headerWriter, version, compression, effort, entry]() { return _ReadChunk(source, headerWriter, version, compression, effort, entry); };
+	if (_pool)
+	{
+		_pending.push_back(_pool->Submit(read));
+	}
+	else
+	{
+		// Deferred, so it runs on our thread when it's popped.
+		_pending.push_back(async(launch::deferred, read));
+	}
+}
+
+RebuildChunk ResourceReadAhead::Pop()
+{
+	RebuildChunk chunk = _pending.front().get();
+	_pending.pop_front();
+	return chunk;
+}
@@ -14,6 +14,9 @@
 #pragma once
 
 #include "ResourceBlob.h"
+#include "BufferedFileWriter.h"
+#include "ThreadPool.h"
+#include "MappedFile.h"
 
 // This file describes various resource sources and the base classes needed for:
 // (1) resource.map/resource.xxx
@@ -39,6 +42,24 @@ struct RebuildStats
 {
 	size_t ItemCount;
 	size_t TotalSize;
+	double Seconds;		// Wall clock time spent on resources of this type.
+};
+
+enum class RebuildCompression
+{
+	Preserve,	// Resources are copied as they're stored.
+	Best,		// Each resource is re-compressed with whichever method makes it smallest (see CompressResourceData).
+};
+
+struct RebuildOptions
+{
+	RebuildOptions() : ThreadCount(0), ReadAheadLimit(64), WriteBufferSize(256 * 1024), Compression(RebuildCompression::Preserve), CompressionEffort(DefaultCompressionEffort) {}
+
+	size_t ThreadCount;			// Threads used to read (and compress) resources ahead of the writer. 0 means one per hardware thread, 1 means no extra threads.
+	size_t ReadAheadLimit;		// Max number of resources held in memory waiting to be written.
+	uint32_t WriteBufferSize;	// Size of the buffer through which the volume is written.
+	RebuildCompression Compression;
+	int CompressionEffort;		// From 1 (fastest) to 9 (smallest), for RebuildCompression::Best.
 };
 
 typedef ResourceHeaderAgnostic(*ReadResourceHeaderFunc)(sci::istream &byteStream, SCIVersion version, ResourceSourceFlags sourceFlags, uint16_t packageHint);
@@ -115,9 +136,11 @@ public:
 	virtual bool ReadNextEntry(ResourceTypeFlags typeFlags, IteratorState &state, ResourceMapEntryAgnostic &entry, std::vector<uint8_t> *optionalRawData = nullptr) = 0;
 	virtual sci::istream GetHeaderAndPositionedStream(const ResourceMapEntryAgnostic &mapEntry, ResourceHeaderAgnostic &headerEntry) = 0;
 	virtual sci::istream GetPositionedStreamAndResourceSizeIncludingHeader(const ResourceMapEntryAgnostic &mapEntry, uint32_t &size, bool &includesHeader) = 0;
+	// Like GetHeaderAndPositionedStream, but for when the resource data isn't needed. Sources can avoid reading more than the header.
+	virtual void ReadHeader(const ResourceMapEntryAgnostic &mapEntry, ResourceHeaderAgnostic &headerEntry) { GetHeaderAndPositionedStream(mapEntry, headerEntry); }
 
 	virtual void RemoveEntry(const ResourceMapEntryAgnostic &mapEntry) = 0;
-	virtual void RebuildResources(bool force, ResourceSource &source, std::map<ResourceType, RebuildStats> &stats) = 0;
+	virtual void RebuildResources(bool force, ResourceSource &source, const RebuildOptions &options, std::map<ResourceType, RebuildStats> &stats) = 0;
 	virtual AppendBehavior AppendResources(const std::vector<const ResourceBlob*> &blobs) = 0;
 };
 
@@ -133,6 +156,15 @@ extern SourceTraits resourceMapSourceTraits;
 extern SourceTraits messageMapSourceTraits;
 extern SourceTraits altMapSourceTraits;
 
+// Data to be added to the end of an existing volume file.
+struct VolumeAppend
+{
+	VolumeAppend() : Offset(0) {}
+
+	uint32_t Offset;	// The size of the volume before appending (where Data will go).
+	sci::ostream Data;
+};
+
 struct FileDescriptorBase
 {
 	FileDescriptorBase(const std::string &gameFolder, SourceTraits &traits, ResourceSourceFlags sourceFlags) : _gameFolder(gameFolder), _traits(traits), SourceFlags(sourceFlags) {}
@@ -146,10 +178,10 @@ struct FileDescriptorBase
 	std::string _GetMapFilenameBak() const;
 	std::string _GetVolumeFilenameBak(int volume) const;
 
+	// Maps are small and get replaced whenever a resource is added, so they're copied rather than mapped.
 	std::unique_ptr<sci::streamOwner> OpenMap() const
 	{
-		ScopedFile scoped(_GetMapFilename(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING);
-		return std::make_unique<sci::streamOwner>(scoped.hFile);
+		return std::make_unique<sci::streamOwner>(g_mappedFileCache.Open(_GetMapFilename(), MappedFileMode::Copy));
 	}
 
 	bool DoesMapExist() const
@@ -157,10 +189,11 @@ struct FileDescriptorBase
 		return !!PathFileExists(_GetMapFilename().c_str());
 	}
 
+	// Volumes are memory mapped, so only the parts we read are loaded. Sources that have the same volume
+	// open share the view. Views need to be released (e.g. _ResetStreams) before the volume is replaced.
 	std::unique_ptr<sci::streamOwner> OpenVolume(int volumeNumber) const
 	{
-		ScopedFile scoped(_GetVolumeFilename(volumeNumber), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING);
-		return std::make_unique<sci::streamOwner>(scoped.hFile);
+		return std::make_unique<sci::streamOwner>(g_mappedFileCache.Open(_GetVolumeFilename(volumeNumber)));
 	}
 
 	bool DoesVolumeExist(int volumeNumber) const
@@ -168,34 +201,52 @@ struct FileDescriptorBase
 		return !!PathFileExists(_GetVolumeFilename(volumeNumber).c_str());
 	}
 
+	// Returns 0 if the volume doesn't exist yet.
+	uint32_t GetVolumeSize(int volumeNumber) const;
+
+	// Appends data to the end of the volumes without touching what's already there, then swaps in the new map.
+	// The old map remains valid until the final rename, so if we fail partway through, the game is left as it was
+	// (plus some unreferenced bytes at the end of the volumes, which we try to trim off).
+	void AppendToVolumesAndReplaceMap(const sci::ostream &mapStream, const std::unordered_map<int, VolumeAppend> &volumeAppends) const;
+
 	void WriteAndReplaceMapAndVolumes(const sci::ostream &mapStream, const std::unordered_map<int, sci::ostream> &volumeWriteStreams) const
 	{
 		// TODO: Verify we can write to the orignal files. Or do we need to bother? We'll produce nice error messages anyway.
 		// The only time it might be necessary is for .scr and .hep files, since we need those to both succeed or both fail
 
+		// Write the volumes to their bak files.
+		std::vector<int> volumeNumbers;
+		for (const auto &volumeStream : volumeWriteStreams)
 		{
-			// Write the volumes to their bak files.
-			for (const auto &volumeStream : volumeWriteStreams)
-			{
-				ScopedFile holderPackage(_GetVolumeFilenameBak(volumeStream.first), GENERIC_WRITE, 0, CREATE_ALWAYS);
-				holderPackage.Write(volumeStream.second.GetInternalPointer(), volumeStream.second.GetDataSize());
-			}
+			ScopedFile holderPackage(_GetVolumeFilenameBak(volumeStream.first), GENERIC_WRITE, 0, CREATE_ALWAYS);
+			holderPackage.Write(volumeStream.second.GetInternalPointer(), volumeStream.second.GetDataSize());
+			volumeNumbers.push_back(volumeStream.first);
+		}
 
+		ReplaceMapAndVolumes(mapStream, volumeNumbers);
+	}
+
+	// For when the new volumes have already been written to their bak files.
+	void ReplaceMapAndVolumes(const sci::ostream &mapStream, const std::vector<int> &volumeNumbers) const
+	{
+		{
 			// Now the map
 			ScopedFile holderMap(_GetMapFilenameBak(), GENERIC_WRITE, 0, CREATE_ALWAYS);
 			holderMap.Write(mapStream.GetInternalPointer(), mapStream.GetDataSize());
 		}
 
 		// Move the volumes over
-		for (const auto &volumeStream : volumeWriteStreams)
+		for (int volumeNumber : volumeNumbers)
 		{
-			std::string package_name = _GetVolumeFilename( volumeStream.first);
+			std::string package_name = _GetVolumeFilename(volumeNumber);
+			g_mappedFileCache.Invalidate(package_name);
 			deletefile(package_name);
-			movefile(_GetVolumeFilenameBak( volumeStream.first), package_name);
+			movefile(_GetVolumeFilenameBak(volumeNumber), package_name);
 		}
 
 		// Nothing to do at this point if it fails.
 		std::string resmap_name = _GetMapFilename();
+		g_mappedFileCache.Invalidate(resmap_name);
 		deletefile(resmap_name);
 		movefile(_GetMapFilenameBak(), resmap_name);
 	}
@@ -216,14 +267,63 @@ struct FileDescriptorAltMap : public FileDescriptorBase
 
 bool IsResourceCompatible(const SCIVersion &version, const ResourceBlob &blob);
 
+// A resource's bytes as they should appear in a rebuilt volume: the versioned header followed by its (still compressed) data.
+struct RebuildChunk
+{
+	ResourceMapEntryAgnostic Entry;
+	std::unique_ptr<sci::ostream> Data;	// null if the resource couldn't be read (e.g. it's corrupt)
+	uint32_t ResourceSize;				// Size as it will be stored (not including any header we had to add to a patch file's data)
+};
+
+//
+// Reads resources from a source on a pool of worker threads, so that the next resources are ready by the time
+// the writer needs them. Chunks come out in the same order that entries were pushed. No more than
+// RebuildOptions::ReadAheadLimit chunks are held at once. Re-compression (RebuildOptions::Compression) also
+// happens on the worker threads.
+//
+// The source's GetPositionedStreamAndResourceSizeIncludingHeader must be safe to call from multiple threads.
+//
+class ResourceReadAhead
+{
+public:
+	ResourceReadAhead(ResourceSource &source, WriteResourceHeaderFunc headerWriter, SCIVersion version, const RebuildOptions &options);
+	ResourceReadAhead(const ResourceReadAhead &src) = delete;
+	ResourceReadAhead &operator=(const ResourceReadAhead &src) = delete;
+
+	void Push(const ResourceMapEntryAgnostic &entry);
+	bool IsFull() const { return _pending.size() >= _limit; }
+	bool IsEmpty() const { return _pending.empty(); }
+
+	// Returns the chunk for the oldest entry pushed, waiting for it if necessary.
+	RebuildChunk Pop();
+
+private:
+	static RebuildChunk _ReadChunk(ResourceSource &source, WriteResourceHeaderFunc headerWriter, SCIVersion version, RebuildCompression compression, int effort, const ResourceMapEntryAgnostic &entry);
+	static bool _ReadCompressedChunk(ResourceSource &source, WriteResourceHeaderFunc headerWriter, SCIVersion version, int effort, RebuildChunk &chunk);
+
+	ResourceSource &_source;
+	WriteResourceHeaderFunc _headerWriter;
+	SCIVersion _version;
+	RebuildCompression _compression;
+	int _effort;
+	size_t _limit;
+
+	// null if we're reading on the calling thread. Declared before _pending so that any outstanding
+	// reads are finished before we go away.
+	std::unique_ptr<ThreadPool> _pool;
+	std::deque<std::future<RebuildChunk>> _pending;
+};
+
 // Use for resource.map, alt.map, message.map and such.
 template<typename _TNavigator, typename _FileDescriptor>
 class MapAndPackageSource : public ResourceSource, public _TNavigator, public _FileDescriptor
 {
 public:
-	MapAndPackageSource(SCIVersion version, ResourceHeaderReadWrite headerReadWrite, const std::string &gameFolder) :
+	// compressAppends: appended resources are compressed (with CompressResourceData) instead of being stored as they are.
+	MapAndPackageSource(SCIVersion version, ResourceHeaderReadWrite headerReadWrite, const std::string &gameFolder, bool compressAppends = false) :
 		_headerReadWrite(headerReadWrite),
 		_version(version),
+		_compressAppends(compressAppends),
 		_FileDescriptor(gameFolder)
 		{}
 
@@ -338,12 +438,13 @@ public:
 			FinalizeMapStreams(mapStreamWrite1, mapStreamWrite2);
 
 			// Now we have mapStreamWrite1 and volumeStreamWrite that have the needed data.
-			// Let's ask the _FileDescriptor to replace things.
+			// Let's ask the _FileDescriptor to replace things (after letting go of the files).
+			_ResetStreams();
 			this->WriteAndReplaceMapAndVolumes(mapStreamWrite1, volumeStreamWrites);
 		}
 	}
 
-	void RebuildResources(bool force, ResourceSource &source, std::map<ResourceType, RebuildStats> &stats) override
+	void RebuildResources(bool force, ResourceSource &source, const RebuildOptions &options, std::map<ResourceType, RebuildStats> &stats) override
 	{
 		IteratorState iteratorState;
 
@@ -351,88 +452,111 @@ public:
 		std::unordered_set<int> encounteredResources[NumResourceTypes];
 
 		int rebuildPackageNumber = _version.DefaultVolumeFile;
-		std::unordered_map<int, sci::ostream> volumeWriteStreams;
-		// This is a large amount of data, so minimize reallocations.
-		volumeWriteStreams[rebuildPackageNumber].EnsureCapacity(4 * 1024 * 1024);
 
 		// Our two map streams:
 		sci::ostream mapStreamWrite1;
 		sci::ostream mapStreamWrite2;
 
-		ResourceMapEntryAgnostic entryExisting;
-		while (source.ReadNextEntry(ResourceTypeFlags::All, iteratorState, entryExisting, nullptr))
 		{
-			int type = (int)entryExisting.Type;
-			if (type < ARRAYSIZE(encounteredResources))
+			// The volume is written straight to its bak file as we go, instead of accumulating the whole thing in memory.
+			BufferedFileWriter volumeWriter(this->_GetVolumeFilenameBak(rebuildPackageNumber), options.WriteBufferSize);
+			// Resources are read (on other threads) ahead of where we're writing.
+			ResourceReadAhead readAhead(source, _headerReadWrite.writer, _version, options);
+
+			ResourceMapEntryAgnostic entryExisting;
+			while (source.ReadNextEntry(ResourceTypeFlags::All, iteratorState, entryExisting, nullptr))
 			{
-				if (encounteredResources[type].find(entryExisting.Number) == encounteredResources[type].end())
+				int type = (int)entryExisting.Type;
+				if (type < ARRAYSIZE(encounteredResources))
 				{
-					// Add it
-					encounteredResources[type].insert(entryExisting.Number);
-
-					// Take note of the offset of the volume we're writing to
-					_TNavigator::EnsureResourceAlignment(volumeWriteStreams[rebuildPackageNumber]);
-					uint32_t newResourceOffset = volumeWriteStreams[rebuildPackageNumber].tellp();
-
-					// Copy the resource data over
-					// We don't really care about the headerEntry. All we need to know is the position and size of the data
-					// we want to copy. The position is given by the mapentry offset, and the size is the cbCompressed plus the
-					// header size. Hmm, but we don't know the header size. I guess we could have another function that is
-					uint32_t totalResourceSize;
-					try
+					if (encounteredResources[type].find(entryExisting.Number) == encounteredResources[type].end())
 					{
-						bool includesHeader;
-						sci::istream volumneReadStream = source.GetPositionedStreamAndResourceSizeIncludingHeader(entryExisting, totalResourceSize, includesHeader);
-
-						if (!includesHeader)
+						// Add it
+						encounteredResources[type].insert(entryExisting.Number);
+						readAhead.Push(entryExisting);
+						while (readAhead.IsFull())
 						{
-							// This is the case for when we put patch files into the resource map.
-							ResourceHeaderAgnostic header;
-							header.cbCompressed = totalResourceSize;
-							header.cbDecompressed = totalResourceSize;
-							header.Base36Number = entryExisting.Base36Number;
-							header.Number = entryExisting.Number;
-							header.PackageHint = entryExisting.PackageNumber;
-							header.Type = entryExisting.Type;
-							header.Version = this->_version;
-							header.CompressionMethod = 0;
-							(*_headerReadWrite.writer)(volumeWriteStreams[rebuildPackageNumber], header);
+							_WriteRebuildChunk(readAhead, volumeWriter, rebuildPackageNumber, mapStreamWrite1, mapStreamWrite2, stats);
 						}
-						// else the data we're copying already includes the header.
-
-						// Now transfer this to the write stream
-						transfer(volumneReadStream, volumeWriteStreams[rebuildPackageNumber], totalResourceSize);
-
-						// Then write this entry to the map, after modifying our map header's offset accordingly 
-						entryExisting.Offset = newResourceOffset;
-						entryExisting.PackageNumber = rebuildPackageNumber;
-						WriteEntry(entryExisting, mapStreamWrite1, mapStreamWrite2, false);
-
-						auto &statsForType = stats[entryExisting.Type];
-						statsForType.ItemCount++;
-						statsForType.TotalSize += totalResourceSize;
-					}
-					catch (std::exception)
-					{
-						// Corrupt resources (e.g. zero size, or invalid map entries) shouldn't prevent us from re-building.
 					}
 				}
 			}
+			while (!readAhead.IsEmpty())
+			{
+				_WriteRebuildChunk(readAhead, volumeWriter, rebuildPackageNumber, mapStreamWrite1, mapStreamWrite2, stats);
+			}
+
+			volumeWriter.Flush();
 		}
 
+		// We're about to replace the files our views are of.
+		_ResetStreams();
+
 		// Combine the two write streams. Or rather, append stream 2 to the end of stream 1.
 		FinalizeMapStreams(mapStreamWrite1, mapStreamWrite2);
 
-		// Now we have mapStreamWrite1 and volumeStreamWrite that have the needed data.
+		// Now we have mapStreamWrite1 and the volume bak file that have the needed data.
 		// Let's ask the _FileDescriptor to replace things.
-		this->WriteAndReplaceMapAndVolumes(mapStreamWrite1, volumeWriteStreams);
+		this->ReplaceMapAndVolumes(mapStreamWrite1, { rebuildPackageNumber });
 	}
 
 	virtual ::AppendBehavior AppendResources(const std::vector<const ResourceBlob*> &blobs)
 	{
-		// For this, we append the resource data to the end of the volume file.
-		// We could have any number of volumes being saved to, so we'll use a map.
-		std::unordered_map<int, sci::ostream> volumeWriteStreams;
+		if (!_TryAppendResourcesInPlace(blobs))
+		{
+			// The new resources would sit past the largest offset a map entry can express. Rebuilding drops
+			// older copies of resources that were superseded, and might free up enough room.
+			std::map<ResourceType, RebuildStats> stats;
+			RebuildOptions options;
+			options.Compression = _compressAppends ? RebuildCompression::Best : RebuildCompression::Preserve;
+			RebuildResources(true, *this, options, stats);
+			if (!_TryAppendResourcesInPlace(blobs))
+			{
+				throw std::exception("The resource volume is too large to add any more resources.");
+			}
+		}
+		return _TNavigator::AppendBehavior;
+	}
+
+protected:
+	void _ResetStreams()
+	{
+		_map = nullptr;
+		_mapStream = nullptr;
+		_volumeStreams.clear();
+		_TNavigator::ResetNavigation();
+	}
+
+	void _WriteRebuildChunk(ResourceReadAhead &readAhead, BufferedFileWriter &volumeWriter, int rebuildPackageNumber, sci::ostream &mapStreamWrite1, sci::ostream &mapStreamWrite2, std::map<ResourceType, RebuildStats> &stats)
+	{
+		auto start = std::chrono::steady_clock::now();
+		RebuildChunk chunk = readAhead.Pop();
+		if (chunk.Data)
+		{
+			// Take note of the offset of the volume we're writing to
+			uint32_t newResourceOffset = volumeWriter.tellp();
+			_TNavigator::EnsureResourceAlignment(newResourceOffset);
+			volumeWriter.FillByte(0, newResourceOffset - volumeWriter.tellp());
+
+			volumeWriter.WriteBytes(chunk.Data->GetInternalPointer(), chunk.Data->GetDataSize());
+
+			// Then write this entry to the map, after modifying our map header's offset accordingly 
+			chunk.Entry.Offset = newResourceOffset;
+			chunk.Entry.PackageNumber = rebuildPackageNumber;
+			WriteEntry(chunk.Entry, mapStreamWrite1, mapStreamWrite2, false);
+
+			auto &statsForType = stats[chunk.Entry.Type];
+			statsForType.ItemCount++;
+			statsForType.TotalSize += chunk.ResourceSize;
+			statsForType.Seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+
+	bool _TryAppendResourcesInPlace(const std::vector<const ResourceBlob*> &blobs)
+	{
+		// For this, we append the resource data to the end of the volume file. Only the new data is written, rather
+		// than a copy of the whole volume. We could have any number of volumes being saved to, so we'll use a map.
+		std::unordered_map<int, VolumeAppend> volumeAppends;
 
 		sci::ostream mapStreamWriteMain;
 		sci::ostream mapStreamWriteSecondary;
@@ -444,17 +568,25 @@ public:
 			assert(IsResourceCompatible(_version, *blob));
 			ResourceHeaderAgnostic header = blob->GetHeader();
 
-			// Possibly copy over a new volume, if we haven't written to it yet
-			if (volumeWriteStreams.find(header.PackageHint) == volumeWriteStreams.end())
+			if (volumeAppends.find(header.PackageHint) == volumeAppends.end())
 			{
-				sci::istream volumeReadStream = _GetVolumeStream(blob->GetPackageHint());
-				volumeReadStream.seekg(0);
-				transfer(volumeReadStream, volumeWriteStreams[header.PackageHint], volumeReadStream.getBytesRemaining());
+				volumeAppends[header.PackageHint].Offset = this->GetVolumeSize(header.PackageHint);
+			}
+			VolumeAppend &volumeAppend = volumeAppends[header.PackageHint];
+
+			// Take note of the offset so we can create a map entry. Alignment applies to the offset in the
+			// volume, not in our append buffer.
+			uint32_t resourceOffset = volumeAppend.Offset + volumeAppend.Data.tellp();
+			uint32_t alignedOffset = resourceOffset;
+			_TNavigator::EnsureResourceAlignment(alignedOffset);
+			volumeAppend.Data.FillByte(0, alignedOffset - resourceOffset);
+			resourceOffset = alignedOffset;
+			if ((resourceOffset > _TNavigator::GetMaxResourceOffset()) || (resourceOffset < volumeAppend.Offset))
+			{
+				// Forget about the new entries the navigator is tracking.
+				_ResetStreams();
+				return false;
 			}
-
-			// Take note of the offset so we can create a map entry
-			_TNavigator::EnsureResourceAlignment(volumeWriteStreams[header.PackageHint]);
-			uint32_t resourceOffset = volumeWriteStreams[header.PackageHint].tellp();
 
 			// Write the map entry
 			ResourceMapEntryAgnostic newMapEntry;
@@ -464,12 +596,26 @@ public:
 			newMapEntry.Offset = resourceOffset;
 			WriteEntry(newMapEntry, mapStreamWriteMain, mapStreamWriteSecondary, true);
 
-			// Write the header to the volume
-			header.CompressionMethod = 0; // We never write with compression, currently
-			(*_headerReadWrite.writer)(volumeWriteStreams[header.PackageHint], blob->GetHeader());
+			// Write the header to the volume. Unless we've been asked to compress them, appended resources are
+			// written uncompressed (rebuilding with RebuildCompression::Best compresses them later).
+			std::vector<uint8_t> compressed;
+			header.CompressionMethod = 0;
+			if (_compressAppends)
+			{
+				header.CompressionMethod = CompressResourceData(_version, blob->GetData(), blob->GetDecompressedLength(), compressed);
+			}
+			header.cbCompressed = (header.CompressionMethod != 0) ? (uint32_t)compressed.size() : header.cbDecompressed;
+			(*_headerReadWrite.writer)(volumeAppend.Data, header);
 			
 			// Follow the volume header with the actual resource data
-			transfer(blob->GetReadStream(), volumeWriteStreams[header.PackageHint], blob->GetDecompressedLength());
+			if (header.CompressionMethod != 0)
+			{
+				volumeAppend.Data.WriteBytes(&compressed[0], (int)compressed.size());
+			}
+			else
+			{
+				transfer(blob->GetReadStream(), volumeAppend.Data, blob->GetDecompressedLength());
+			}
 		}
 
 		// Now we need to follow up with the rest of the map entries. For SCI0, we could just copy over the original resource map.
@@ -484,16 +630,18 @@ public:
 		// Combine the two write streams. Or rather, append stream 2 to the end of stream 1.
 		FinalizeMapStreams(mapStreamWriteMain, mapStreamWriteSecondary);
 
-		// Now we have mapStreamWrite1 and volumeStreamWrite that have the needed data.
-		// Let's ask the _FileDescriptor to replace things.
-		this->WriteAndReplaceMapAndVolumes(mapStreamWriteMain, volumeWriteStreams);
+		// Let's ask the _FileDescriptor to append to the volumes and replace the map.
+		this->AppendToVolumesAndReplaceMap(mapStreamWriteMain, volumeAppends);
 
-		return _TNavigator::AppendBehavior;
+		// Our cached map (and possibly volumes) are now out of date.
+		_ResetStreams();
+		return true;
 	}
 
-protected:
 	sci::istream _GetVolumeStream(int volumeNumber)
 	{
+		// Resources may be read on multiple threads while rebuilding.
+		std::lock_guard<std::mutex> lock(_volumeMutex);
 		auto result = _volumeStreams.find(volumeNumber);
 		if (result != _volumeStreams.end())
 		{
@@ -517,8 +665,10 @@ protected:
 private:
 	ResourceHeaderReadWrite _headerReadWrite;
 	SCIVersion _version;
+	bool _compressAppends;
 
 	std::unique_ptr<sci::streamOwner> _map;
 	std::unique_ptr<sci::istream> _mapStream;
 	std::unordered_map<int, std::unique_ptr<sci::streamOwner>> _volumeStreams;
+	std::mutex _volumeMutex;
 };
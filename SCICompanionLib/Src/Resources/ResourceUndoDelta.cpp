@@ -0,0 +1,383 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#include "stdafx.h"
+#include "ResourceUndoDelta.h"
+#include "ResourceSourceFlags.h"
+
+using namespace std;
+
+namespace
+{
+	// For components we don't know anything about (e.g. polygons), which are generally small.
+	const size_t UnknownComponentSize = 1024;
+
+	size_t _GetPayloadSize(const PicCommand &command)
+	{
+		switch (command.type)
+		{
+			case PicCommand::SetPalette:
+				return PALETTE_SIZE;
+			case PicCommand::SetPriorityBars:
+				return NumPriorityBars * sizeof(*command.setPriorityBars.pPriorityLines);
+			case PicCommand::DrawBitmap:
+				return sizeof(Cel) + command.drawVisualBitmap.pCel->Data.size();
+		}
+		return 0;
+	}
+
+	size_t _GetCommandsSize(vector<PicCommand>::const_iterator begin, vector<PicCommand>::const_iterator end)
+	{
+		size_t size = (end - begin) * sizeof(PicCommand);
+		for (auto it = begin; it != end; ++it)
+		{
+			size += _GetPayloadSize(*it);
+		}
+		return size;
+	}
+
+	size_t _GetRasterSize(const RasterComponent &raster)
+	{
+		size_t size = sizeof(RasterComponent);
+		for (const Loop &loop : raster.Loops)
+		{
+			size += sizeof(Loop);
+			for (const Cel &cel : loop.Cels)
+			{
+				size += sizeof(Cel) + cel.Data.size();
+			}
+		}
+		return size;
+	}
+
+	size_t _GetComponentSize(const type_index &type, const ResourceComponent &component)
+	{
+		if (type == type_index(typeid(PicComponent)))
+		{
+			const PicComponent &pic = static_cast<const PicComponent&>(component);
+			return sizeof(PicComponent) + _GetCommandsSize(pic.commands.begin(), pic.commands.end());
+		}
+		if (type == type_index(typeid(RasterComponent)))
+		{
+			return _GetRasterSize(static_cast<const RasterComponent&>(component));
+		}
+		if (type == type_index(typeid(PaletteComponent)))
+		{
+			return sizeof(PaletteComponent);
+		}
+		return UnknownComponentSize;
+	}
+
+	// Commands are always fully initialized (including padding), and copies of a command share its
+	// palette/bitmap, so comparing the bytes tells us if it's the same.
+	bool _IsSameCommand(const PicCommand &one, const PicCommand &two)
+	{
+		return 0 == memcmp(&one, &two, sizeof(PicCommand));
+	}
+
+	bool _IsSameCelExceptPixels(const Cel &one, const Cel &two)
+	{
+		return (one.size.cx == two.size.cx) && (one.size.cy == two.size.cy) &&
+			(one.placement.x == two.placement.x) && (one.placement.y == two.placement.y) &&
+			(one.TransparentColor == two.TransparentColor) && (one.Stride32 == two.Stride32) &&
+			(one.Data.size() == two.Data.size());
+	}
+
+	bool _IsSameLoopExceptCels(const Loop &one, const Loop &two)
+	{
+		return (one.Cels.size() == two.Cels.size()) && (one.UnknownData == two.UnknownData) &&
+			(one.IsMirror == two.IsMirror) && (one.MirrorOf == two.MirrorOf);
+	}
+}
+
+ResourceUndoDelta::ResourceUndoDelta() :
+	_hasPicChange(false), _commandStart(0), _commandsRemoved(0), _picUniqueId(0),
+	_hasRasterChange(false), _rasterUnknownData(0), _rasterScaleFlags(0), _rasterResolution(NativeResolution::Res320x200),
+	_hasPaletteChange(false), _paletteCompression(PaletteCompression::None), _paletteEntryType(PaletteEntryType::ThreeByte),
+	_size(sizeof(ResourceUndoDelta))
+{
+}
+
+unique_ptr<ResourceUndoDelta> ResourceUndoDelta::Create(const ResourceEntity &before, const ResourceEntity &after)
+{
+	if ((&before.Traits != &after.Traits) || ((after.GetType() != ResourceType::Pic) && (after.GetType() != ResourceType::View)))
+	{
+		return nullptr;
+	}
+
+	unique_ptr<ResourceUndoDelta> delta(new ResourceUndoDelta());
+	delta->_resourceNumber = after.ResourceNumber;
+	delta->_packageNumber = after.PackageNumber;
+	delta->_base36Number = after.Base36Number;
+	delta->_sourceFlags = after.SourceFlags;
+
+	for (const auto &pair : after.components)
+	{
+		bool diffed = false;
+		auto itBefore = before.components.find(pair.first);
+		if (itBefore != before.components.end())
+		{
+			if (pair.first == type_index(typeid(PicComponent)))
+			{
+				diffed = delta->_DiffPic(static_cast<const PicComponent&>(*itBefore->second), static_cast<const PicComponent&>(*pair.second));
+			}
+			else if (pair.first == type_index(typeid(RasterComponent)))
+			{
+				diffed = delta->_DiffRaster(static_cast<const RasterComponent&>(*itBefore->second), static_cast<const RasterComponent&>(*pair.second));
+			}
+			else if (pair.first == type_index(typeid(PaletteComponent)))
+			{
+				delta->_DiffPalette(static_cast<const PaletteComponent&>(*itBefore->second), static_cast<const PaletteComponent&>(*pair.second));
+				diffed = true;
+			}
+		}
+		if (!diffed)
+		{
+			delta->_copiedComponents.emplace_back(pair.first, unique_ptr<ResourceComponent>(pair.second->Clone()));
+			delta->_size += _GetComponentSize(pair.first, *pair.second);
+		}
+	}
+
+	for (const auto &pair : before.components)
+	{
+		if (after.components.find(pair.first) == after.components.end())
+		{
+			delta->_removedComponents.push_back(pair.first);
+		}
+	}
+	return delta;
+}
+
+bool ResourceUndoDelta::_DiffPic(const PicComponent &before, const PicComponent &after)
+{
+	if (before.Traits != after.Traits)
+	{
+		return false;
+	}
+
+	// Edits generally insert or remove a run of commands, so just find the part in the middle that's different.
+	size_t countBefore = before.commands.size();
+	size_t countAfter = after.commands.size();
+	size_t common = (min)(countBefore, countAfter);
+	size_t prefix = 0;
+	while ((prefix < common) && _IsSameCommand(before.commands[prefix], after.commands[prefix]))
+	{
+		prefix++;
+	}
+	size_t suffix = 0;
+	while ((suffix < (common - prefix)) && _IsSameCommand(before.commands[countBefore - 1 - suffix], after.commands[countAfter - 1 - suffix]))
+	{
+		suffix++;
+	}
+
+	_hasPicChange = true;
+	_commandStart = prefix;
+	_commandsRemoved = countBefore - prefix - suffix;
+	_commandsInserted.assign(after.commands.begin() + prefix, after.commands.begin() + (countAfter - suffix));
+	_picSize = after.Size;
+	_picUniqueId = after.UniqueId;
+	_size += _GetCommandsSize(_commandsInserted.begin(), _commandsInserted.end());
+	return true;
+}
+
+bool ResourceUndoDelta::_DiffRaster(const RasterComponent &before, const RasterComponent &after)
+{
+	// If loops or cels were added or removed, just copy the whole thing.
+	if (before.Loops.size() != after.Loops.size())
+	{
+		return false;
+	}
+	for (size_t nLoop = 0; nLoop < after.Loops.size(); nLoop++)
+	{
+		if (!_IsSameLoopExceptCels(before.Loops[nLoop], after.Loops[nLoop]))
+		{
+			return false;
+		}
+	}
+
+	_hasRasterChange = true;
+	_rasterUnknownData = after.UnknownData;
+	_rasterScaleFlags = after.ScaleFlags;
+	_rasterResolution = after.Resolution;
+	for (size_t nLoop = 0; nLoop < after.Loops.size(); nLoop++)
+	{
+		for (size_t nCel = 0; nCel < after.Loops[nLoop].Cels.size(); nCel++)
+		{
+			const Cel &celBefore = before.Loops[nLoop].Cels[nCel];
+			const Cel &celAfter = after.Loops[nLoop].Cels[nCel];
+			CelChange change;
+			change.Loop = (uint16_t)nLoop;
+			change.Cel = (uint16_t)nCel;
+			if (!_IsSameCelExceptPixels(celBefore, celAfter))
+			{
+				change.WholeCel = make_unique<Cel>(celAfter);
+				_size += sizeof(Cel) + celAfter.Data.size();
+				_celChanges.push_back(move(change));
+				continue;
+			}
+
+			// Find the rectangle (in the cel's data, so including the stride) that changed.
+			int stride = celAfter.GetStride();
+			int rows = stride ? (int)(celAfter.Data.size() / stride) : 0;
+			int left = stride, right = -1, top = rows, bottom = -1;
+			for (int y = 0; y < rows; y++)
+			{
+				const uint8_t *rowBefore = &celBefore.Data[0] + y * stride;
+				const uint8_t *rowAfter = &celAfter.Data[0] + y * stride;
+				if (0 != memcmp(rowBefore, rowAfter, stride))
+				{
+					top = (min)(top, y);
+					bottom = y;
+					int x = 0;
+					while (rowBefore[x] == rowAfter[x])
+					{
+						x++;
+					}
+					left = (min)(left, x);
+					x = stride - 1;
+					while (rowBefore[x] == rowAfter[x])
+					{
+						x--;
+					}
+					right = (max)(right, x);
+				}
+			}
+			if (bottom >= 0)
+			{
+				change.X = left;
+				change.Y = top;
+				change.CX = right - left + 1;
+				change.CY = bottom - top + 1;
+				change.Data.resize(change.CX * change.CY);
+				for (int y = 0; y < change.CY; y++)
+				{
+					memcpy(&change.Data[y * change.CX], &celAfter.Data[0] + (top + y) * stride + left, change.CX);
+				}
+				_size += sizeof(CelChange) + change.Data.size();
+				_celChanges.push_back(move(change));
+			}
+		}
+	}
+	return true;
+}
+
+void ResourceUndoDelta::_DiffPalette(const PaletteComponent &before, const PaletteComponent &after)
+{
+	_hasPaletteChange = true;
+	_paletteCompression = after.Compression;
+	_paletteEntryType = after.EntryType;
+	for (int i = 0; i < ARRAYSIZE(after.Colors); i++)
+	{
+		if ((before.Mapping[i] != after.Mapping[i]) || (0 != memcmp(&before.Colors[i], &after.Colors[i], sizeof(after.Colors[i]))))
+		{
+			_paletteChanges.push_back({ (uint8_t)i, after.Mapping[i], after.Colors[i] });
+		}
+	}
+	_size += _paletteChanges.size() * sizeof(PaletteEntryChange);
+}
+
+void ResourceUndoDelta::Apply(ResourceEntity &resource) const
+{
+	resource.ResourceNumber = _resourceNumber;
+	resource.PackageNumber = _packageNumber;
+	resource.Base36Number = _base36Number;
+	resource.SourceFlags = _sourceFlags;
+
+	for (const type_index &type : _removedComponents)
+	{
+		resource.components.erase(type);
+	}
+	for (const auto &pair : _copiedComponents)
+	{
+		resource.components[pair.first].reset(pair.second->Clone());
+	}
+	if (_hasPicChange)
+	{
+		_ApplyPic(resource.GetComponent<PicComponent>());
+	}
+	if (_hasRasterChange)
+	{
+		_ApplyRaster(resource.GetComponent<RasterComponent>());
+	}
+	if (_hasPaletteChange)
+	{
+		_ApplyPalette(resource.GetComponent<PaletteComponent>());
+	}
+}
+
+void ResourceUndoDelta::_ApplyPic(PicComponent &pic) const
+{
+	auto start = pic.commands.begin() + _commandStart;
+	start = pic.commands.erase(start, start + _commandsRemoved);
+	pic.commands.insert(start, _commandsInserted.begin(), _commandsInserted.end());
+	pic.Size = _picSize;
+	pic.UniqueId = _picUniqueId;
+}
+
+void ResourceUndoDelta::_ApplyRaster(RasterComponent &raster) const
+{
+	raster.UnknownData = _rasterUnknownData;
+	raster.ScaleFlags = _rasterScaleFlags;
+	raster.Resolution = _rasterResolution;
+	for (const CelChange &change : _celChanges)
+	{
+		Cel &cel = raster.Loops[change.Loop].Cels[change.Cel];
+		if (change.WholeCel)
+		{
+			cel = *change.WholeCel;
+		}
+		else
+		{
+			int stride = cel.GetStride();
+			for (int y = 0; y < change.CY; y++)
+			{
+				memcpy(&cel.Data[0] + (change.Y + y) * stride + change.X, &change.Data[y * change.CX], change.CX);
+			}
+		}
+	}
+}
+
+void ResourceUndoDelta::_ApplyPalette(PaletteComponent &palette) const
+{
+	palette.Compression = _paletteCompression;
+	palette.EntryType = _paletteEntryType;
+	for (const PaletteEntryChange &change : _paletteChanges)
+	{
+		palette.Mapping[change.Index] = change.Mapping;
+		palette.Colors[change.Index] = change.Color;
+	}
+}
+
+size_t GetApproximateResourceSize(const ResourceEntity &resource)
+{
+	size_t size = 0;
+	const PicComponent *pic = resource.TryGetComponent<PicComponent>();
+	if (pic)
+	{
+		size += _GetComponentSize(type_index(typeid(PicComponent)), *pic);
+	}
+	const RasterComponent *raster = resource.TryGetComponent<RasterComponent>();
+	if (raster)
+	{
+		size += _GetComponentSize(type_index(typeid(RasterComponent)), *raster);
+	}
+	if (size)
+	{
+		const PaletteComponent *palette = resource.TryGetComponent<PaletteComponent>();
+		if (palette)
+		{
+			size += sizeof(PaletteComponent);
+		}
+	}
+	return size;
+}
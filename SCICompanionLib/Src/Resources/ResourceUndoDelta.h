@@ -0,0 +1,101 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#pragma once
+
+#include "ResourceEntity.h"
+#include "Pic.h"
+#include "View.h"
+#include "PaletteOperations.h"
+
+//
+// What changed in a pic or view from one undo frame to the next, so the undo stack doesn't need a
+// whole copy of the resource for each edit:
+//	- for pics, the range of commands that was replaced
+//	- for views, the rectangle of each cel that changed (or the whole cel, if its size changed)
+//	- for palettes, the entries that changed
+// Any other components (e.g. polygons) are just copied.
+//
+class ResourceUndoDelta
+{
+public:
+	// Returns nullptr if we don't do deltas for this kind of resource.
+	static std::unique_ptr<ResourceUndoDelta> Create(const ResourceEntity &before, const ResourceEntity &after);
+
+	// Turns a copy of before into after.
+	void Apply(ResourceEntity &resource) const;
+
+	// Roughly how much memory this uses.
+	size_t GetSize() const { return _size; }
+
+private:
+	ResourceUndoDelta();
+
+	bool _DiffPic(const PicComponent &before, const PicComponent &after);
+	bool _DiffRaster(const RasterComponent &before, const RasterComponent &after);
+	void _DiffPalette(const PaletteComponent &before, const PaletteComponent &after);
+	void _ApplyPic(PicComponent &pic) const;
+	void _ApplyRaster(RasterComponent &raster) const;
+	void _ApplyPalette(PaletteComponent &palette) const;
+
+	int _resourceNumber;
+	int _packageNumber;
+	uint32_t _base36Number;
+	ResourceSourceFlags _sourceFlags;
+
+	// Pics: the commands in [_commandStart, _commandStart + _commandsRemoved) are replaced by _commandsInserted.
+	bool _hasPicChange;
+	size_t _commandStart;
+	size_t _commandsRemoved;
+	std::vector<PicCommand> _commandsInserted;
+	size16 _picSize;
+	int _picUniqueId;
+
+	// Views
+	struct CelChange
+	{
+		uint16_t Loop;
+		uint16_t Cel;
+		std::unique_ptr<Cel> WholeCel;		// If anything but the pixels changed
+		// Otherwise, the rows and columns of the cel data that changed.
+		int X, Y, CX, CY;
+		std::vector<uint8_t> Data;
+	};
+	bool _hasRasterChange;
+	std::vector<CelChange> _celChanges;
+	uint32_t _rasterUnknownData;
+	uint8_t _rasterScaleFlags;
+	NativeResolution _rasterResolution;
+
+	// Palettes
+	struct PaletteEntryChange
+	{
+		uint8_t Index;
+		uint8_t Mapping;
+		RGBQUAD Color;
+	};
+	bool _hasPaletteChange;
+	std::vector<PaletteEntryChange> _paletteChanges;
+	PaletteCompression _paletteCompression;
+	PaletteEntryType _paletteEntryType;
+
+	// Components that are copied (because they were added, they changed structurally, or we don't
+	// know how to diff them), and ones that were removed.
+	std::vector<std::pair<std::type_index, std::unique_ptr<ResourceComponent>>> _copiedComponents;
+	std::vector<std::type_index> _removedComponents;
+
+	size_t _size;
+};
+
+// Roughly how much memory a copy of this resource uses, or 0 if we don't know.
+size_t GetApproximateResourceSize(const ResourceEntity &resource);
@@ -57,6 +57,7 @@
 #include "SyntaxParser.h"
 #include "ImageUtil.h"
 #include "DependencyTracker.h"
+#include "GameIniCache.h"
 
 // The one and only
 extern AppState *appState;
@@ -774,6 +775,7 @@ HRESULT AppState::_SetGameStringProperty(PCTSTR pszProp, PCTSTR pszValue)
 	if (SUCCEEDED(hr))
 	{
 		hr = WritePrivateProfileString(TEXT("Game"), pszProp, pszValue, szGameIni) ? S_OK : ResultFromLastError();
+		g_gameIniCache.Invalidate(szGameIni);
 	}
 	return hr;
 }
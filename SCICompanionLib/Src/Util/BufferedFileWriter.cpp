@@ -0,0 +1,76 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#include "stdafx.h"
+#include "BufferedFileWriter.h"
+
+BufferedFileWriter::BufferedFileWriter(const std::string &filename, uint32_t bufferSize) :
+	_file(filename, GENERIC_WRITE, 0, CREATE_ALWAYS),
+	_buffer(new uint8_t[bufferSize]),
+	_bufferSize(bufferSize),
+	_bufferUsed(0),
+	_position(0)
+{
+}
+
+void BufferedFileWriter::_WriteBuffer()
+{
+	_file.Write(_buffer.get(), _bufferUsed);
+	_bufferUsed = 0;
+}
+
+void BufferedFileWriter::WriteBytes(const uint8_t *data, uint32_t length)
+{
+	if (length > ((std::numeric_limits<uint32_t>::max)() - _position))
+	{
+		throw std::exception("File too large.");
+	}
+	_position += length;
+	while (length > 0)
+	{
+		if ((_bufferUsed == 0) && (length >= _bufferSize))
+		{
+			// Big enough that there's no point in copying it into the buffer first.
+			_file.Write(data, length);
+			return;
+		}
+
+		uint32_t amount = min(length, _bufferSize - _bufferUsed);
+		memcpy(_buffer.get() + _bufferUsed, data, amount);
+		_bufferUsed += amount;
+		data += amount;
+		length -= amount;
+		if (_bufferUsed == _bufferSize)
+		{
+			_WriteBuffer();
+		}
+	}
+}
+
+void BufferedFileWriter::FillByte(uint8_t value, uint32_t count)
+{
+	uint8_t chunk[64];
+	memset(chunk, value, sizeof(chunk));
+	while (count > 0)
+	{
+		uint32_t amount = min(count, (uint32_t)sizeof(chunk));
+		WriteBytes(chunk, amount);
+		count -= amount;
+	}
+}
+
+void BufferedFileWriter::Flush()
+{
+	_WriteBuffer();
+	_file.Flush();
+}
@@ -0,0 +1,44 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#pragma once
+
+//
+// Writes a new file through a fixed-size buffer, so large files can be produced
+// without holding their entire contents in memory.
+//
+class BufferedFileWriter
+{
+public:
+	BufferedFileWriter(const std::string &filename, uint32_t bufferSize);
+	BufferedFileWriter(const BufferedFileWriter &src) = delete;
+	BufferedFileWriter &operator=(const BufferedFileWriter &src) = delete;
+
+	void WriteBytes(const uint8_t *data, uint32_t length);
+	void FillByte(uint8_t value, uint32_t count);
+
+	// The total number of bytes written so far (including those still buffered).
+	uint32_t tellp() const { return _position; }
+
+	// Writes out any buffered data and flushes it to disk.
+	void Flush();
+
+private:
+	void _WriteBuffer();
+
+	ScopedFile _file;
+	std::unique_ptr<uint8_t[]> _buffer;
+	uint32_t _bufferSize;
+	uint32_t _bufferUsed;
+	uint32_t _position;
+};
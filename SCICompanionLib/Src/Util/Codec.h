@@ -18,9 +18,18 @@ int decompressHuffman(BYTE* dest, BYTE* src, int length, int complength);
 int decompressLZW_1(BYTE *dest, BYTE *src, int length, int complength);
 int decompressLZW(BYTE *dest, BYTE *src, int length, int complength);
 bool decompressDCL(byte *dest, byte *src, uint32_t unpackedSize, uint32_t packedSize);
+// The original bit-at-a-time DCL decoder, which decompressDCL replaced. It reads up to 4 bytes past the end of src.
+bool decompressDCLReference(byte *dest, byte *src, uint32_t unpackedSize, uint32_t packedSize);
 bool decompressLZS(byte *dest, byte *src, uint32_t unpackedSize, uint32_t packedSize);
 int decrypt4(byte* dest, byte* src, int length, int complength);
 
+// Encoders whose output the corresponding decoders above accept. The output may be larger than the input.
+void compressHuffman(const BYTE *src, int length, std::vector<BYTE> &dest);
+void compressLZW_1(const BYTE *src, int length, std::vector<BYTE> &dest);
+void compressLZW(const BYTE *src, int length, std::vector<BYTE> &dest);
+// effort is from 1 (fastest) to 9 (smallest)
+void compressDCL(const byte *src, uint32_t length, std::vector<byte> &dest, bool asciiMode, int effort);
+
 /*** INITIALIZATION RESULT TYPES ***/
 #define SCI_ERROR_IO_ERROR 1
 #define SCI_ERROR_EMPTY_OBJECT 2
@@ -312,9 +312,493 @@ bool DecompressorDCL::unpack(ReadStream *src, byte *dest, uint32_t nPacked, uint
 	return _dwWrote == _szUnpacked;
 }
 
-bool decompressDCL(byte *dest, byte *src, uint32_t unpackedSize, uint32_t packedSize)
+bool decompressDCLReference(byte *dest, byte *src, uint32_t unpackedSize, uint32_t packedSize)
 {
 	ReadStream readStream(src);
 	DecompressorDCL dcl;
 	return dcl.unpack(&readStream, dest, packedSize, unpackedSize);
 }
+
+//
+// A faster DCL decoder, which does the same thing as DecompressorDCL::unpack. The trees are decoded several bits
+// at a time using lookup tables, and bits come from a 64 bit buffer that's refilled 8 bytes at a time, straight
+// from the source buffer.
+//
+
+// Codes up to this long are decoded with a single lookup. Only the ascii tree has longer ones (up to 13 bits),
+// and those are rare.
+#define DCL_LOOKUP_BITS 9
+
+struct DCLDecodeEntry
+{
+	uint16_t value;		// The decoded value, or (if !isLeaf) the position in the tree after length bits.
+	uint8_t length;		// Number of bits consumed
+	bool isLeaf;
+};
+
+struct DCLDecodeTable
+{
+	DCLDecodeTable(const int *tree) : tree(tree)
+	{
+		for (int index = 0; index < (1 << DCL_LOOKUP_BITS); index++)
+		{
+			int pos = 0;
+			uint8_t length = 0;
+			while (!(tree[pos] & HUFFMAN_LEAF) && (length < DCL_LOOKUP_BITS))
+			{
+				pos = ((index >> length) & 1) ? (tree[pos] & 0xfff) : (tree[pos] >> 12);
+				length++;
+			}
+			bool isLeaf = (tree[pos] & HUFFMAN_LEAF) != 0;
+			entries[index] = { (uint16_t)(isLeaf ? (tree[pos] & 0xffff) : pos), length, isLeaf };
+		}
+	}
+
+	const int *tree;
+	DCLDecodeEntry entries[1 << DCL_LOOKUP_BITS];
+};
+
+struct DCLDecodeTables
+{
+	DCLDecodeTables() : lengths(length_tree), distances(distance_tree), ascii(ascii_tree) {}
+
+	DCLDecodeTable lengths;
+	DCLDecodeTable distances;
+	DCLDecodeTable ascii;
+};
+
+static const DCLDecodeTables &getDCLDecodeTables()
+{
+	static DCLDecodeTables tables;
+	return tables;
+}
+
+class DCLBitReader
+{
+public:
+	DCLBitReader(const byte *src, uint32_t size) : _src(src), _end(src + size), _bits(0), _nBits(0) {}
+
+	// Makes sure at least 32 bits are buffered, which is enough for any (length, distance) pair or literal.
+	// Past the end of the data, we read zeros.
+	void refill()
+	{
+		if (_nBits < 32)
+		{
+			if ((_end - _src) >= 8)
+			{
+				// Little-endian, so the first byte ends up in the lowest bits. This fills the buffer to 56-63 bits.
+				uint64_t word;
+				memcpy(&word, _src, sizeof(word));
+				_bits |= word << _nBits;
+				_src += (63 - _nBits) >> 3;
+				_nBits |= 56;
+			}
+			else
+			{
+				while (_nBits <= 56)
+				{
+					uint64_t value = (_src < _end) ? *_src++ : 0;
+					_bits |= value << _nBits;
+					_nBits += 8;
+				}
+			}
+		}
+	}
+
+	uint32_t peek(int n) const { return (uint32_t)_bits & ((1u << n) - 1); }
+	void consume(int n) { _bits >>= n; _nBits -= n; }
+	uint32_t get(int n) { uint32_t value = peek(n); consume(n); return value; }
+
+	int decode(const DCLDecodeTable &table)
+	{
+		const DCLDecodeEntry &entry = table.entries[peek(DCL_LOOKUP_BITS)];
+		consume(entry.length);
+		if (entry.isLeaf)
+		{
+			return entry.value;
+		}
+		// Finish off a long code one bit at a time.
+		int pos = entry.value;
+		while (!(table.tree[pos] & HUFFMAN_LEAF))
+		{
+			pos = get(1) ? (table.tree[pos] & 0xfff) : (table.tree[pos] >> 12);
+		}
+		return table.tree[pos] & 0xffff;
+	}
+
+private:
+	const byte *_src;
+	const byte *_end;
+	uint64_t _bits;
+	int _nBits;
+};
+
+bool decompressDCL(byte *dest, byte *src, uint32_t unpackedSize, uint32_t packedSize)
+{
+	const DCLDecodeTables &tables = getDCLDecodeTables();
+	DCLBitReader reader(src, packedSize);
+	reader.refill();
+	int mode = reader.get(8);
+	int length_param = reader.get(8);
+
+	if (mode != DCL_BINARY_MODE && mode != DCL_ASCII_MODE) {
+		appState->LogInfo("DCL-INFLATE: Error: Encountered mode %02x, expected 00 or 01", mode);
+		return false;
+	}
+
+	if (length_param < 3 || length_param > 6)
+		appState->LogInfo("Unexpected length_param value %d (expected in [3,6])", length_param);
+
+	uint32_t written = 0;
+	while (written < unpackedSize)
+	{
+		reader.refill();
+		if (reader.get(1))
+		{
+			// (length,distance) pair
+			uint32_t val_length;
+			int value = reader.decode(tables.lengths);
+			if (value < 8)
+				val_length = value + 2;
+			else
+				val_length = 8 + (1 << (value - 7)) + reader.get(value - 7);
+
+			value = reader.decode(tables.distances);
+			int lowBits = (val_length == 2) ? 2 : length_param;
+			uint32_t val_distance = ((value << lowBits) | reader.get(lowBits)) + 1;
+
+			if (val_length + written > unpackedSize) {
+				appState->LogInfo("DCL-INFLATE Error: Write out of bounds while copying %d bytes (declared unpacked size is %d bytes, current is %d + %d bytes)",
+					val_length, unpackedSize, written, val_length);
+				return false;
+			}
+
+			if (written < val_distance) {
+				appState->LogInfo("DCL-INFLATE Error: Attempt to copy from before beginning of input stream (declared unpacked size is %d bytes, current is %d bytes)",
+					unpackedSize, written);
+				return false;
+			}
+
+			byte *out = dest + written;
+			const byte *from = out - val_distance;
+			if (val_distance >= val_length)
+			{
+				memcpy(out, from, val_length);
+			}
+			else
+			{
+				// Overlapping, so this repeats the last val_distance bytes.
+				for (uint32_t i = 0; i < val_length; i++)
+				{
+					out[i] = from[i];
+				}
+			}
+			written += val_length;
+		}
+		else
+		{
+			// Copy byte verbatim
+			dest[written++] = (byte)((mode == DCL_ASCII_MODE) ? reader.decode(tables.ascii) : reader.get(8));
+		}
+	}
+	return true;
+}
+
+//
+// DCL (PKWARE implode) compression. This produces what DecompressorDCL::unpack reads: literals and
+// (length, distance) pairs, coded with the fixed trees above.
+//
+
+struct DCLCode
+{
+	uint16_t bits;		// The first bit to write is the lowest one.
+	uint8_t length;
+};
+
+// The codes for each value in the trees above.
+struct DCLCodeTables
+{
+	DCLCodeTables()
+	{
+		build(length_tree, 0, 0, 0, lengthCodes);
+		build(distance_tree, 0, 0, 0, distanceCodes);
+		build(ascii_tree, 0, 0, 0, asciiCodes);
+	}
+
+	static void build(const int *tree, int pos, uint16_t bits, uint8_t length, DCLCode *codes)
+	{
+		if (tree[pos] & HUFFMAN_LEAF)
+		{
+			codes[tree[pos] & 0xffff] = { bits, length };
+		}
+		else
+		{
+			// huffman_lookup goes left (the upper 12 bits) on a 0, right on a 1.
+			build(tree, tree[pos] >> 12, bits, length + 1, codes);
+			build(tree, tree[pos] & 0xfff, bits | (1 << length), length + 1, codes);
+		}
+	}
+
+	DCLCode lengthCodes[16];
+	DCLCode distanceCodes[64];
+	DCLCode asciiCodes[256];
+};
+
+static const DCLCodeTables &getDCLCodeTables()
+{
+	static DCLCodeTables tables;
+	return tables;
+}
+
+#define DCL_MIN_MATCH 2
+#define DCL_MAX_MATCH 518
+#define DCL_END_OF_STREAM 519
+
+class CompressorDCL
+{
+public:
+	CompressorDCL(std::vector<byte> &dest, bool asciiMode, int distanceBits) :
+		_dest(dest), _tables(getDCLCodeTables()), _asciiMode(asciiMode), _distanceBits(distanceBits), _dwBits(0), _nBits(0) {}
+
+	void pack(const byte *src, uint32_t length, int effort);
+
+	// Approximate cost in bits, used to decide between literals and short matches.
+	int literalCost(byte value) const
+	{
+		return 1 + (_asciiMode ? _tables.asciiCodes[value].length : 8);
+	}
+
+	int matchCost(uint32_t length, uint32_t distance) const
+	{
+		int lengthValue, extraBits;
+		getLengthCode(length, lengthValue, extraBits);
+		int lowBits = (length == 2) ? 2 : _distanceBits;
+		return 1 + _tables.lengthCodes[lengthValue].length + extraBits + _tables.distanceCodes[(distance - 1) >> lowBits].length + lowBits;
+	}
+
+protected:
+	static void getLengthCode(uint32_t length, int &value, int &extraBits)
+	{
+		if (length < 10)
+		{
+			value = length - 2;
+			extraBits = 0;
+		}
+		else
+		{
+			// 8 + (1 << extraBits) + extra
+			extraBits = 1;
+			while ((8u + (2u << extraBits)) <= length)
+			{
+				extraBits++;
+			}
+			value = extraBits + 7;
+		}
+	}
+
+	void putBitsLSB(uint32_t value, int n)
+	{
+		_dwBits |= value << _nBits;
+		_nBits += n;
+		while (_nBits >= 8)
+		{
+			_dest.push_back((byte)_dwBits);
+			_dwBits >>= 8;
+			_nBits -= 8;
+		}
+	}
+
+	void putCode(const DCLCode &code)
+	{
+		putBitsLSB(code.bits, code.length);
+	}
+
+	void putLiteral(byte value)
+	{
+		putBitsLSB(0, 1);
+		if (_asciiMode)
+		{
+			putCode(_tables.asciiCodes[value]);
+		}
+		else
+		{
+			putBitsLSB(value, 8);
+		}
+	}
+
+	void putLength(uint32_t length)
+	{
+		int value, extraBits;
+		getLengthCode(length, value, extraBits);
+		putBitsLSB(1, 1);
+		putCode(_tables.lengthCodes[value]);
+		if (extraBits)
+		{
+			putBitsLSB(length - 8 - (1 << extraBits), extraBits);
+		}
+	}
+
+	void putMatch(uint32_t length, uint32_t distance)
+	{
+		putLength(length);
+		int lowBits = (length == 2) ? 2 : _distanceBits;
+		uint32_t value = distance - 1;
+		putCode(_tables.distanceCodes[value >> lowBits]);
+		putBitsLSB(value & ((1 << lowBits) - 1), lowBits);
+	}
+
+	void flush()
+	{
+		if (_nBits > 0)
+		{
+			_dest.push_back((byte)_dwBits);
+		}
+		_dwBits = 0;
+		_nBits = 0;
+	}
+
+	std::vector<byte> &_dest;
+	const DCLCodeTables &_tables;
+	bool _asciiMode;
+	int _distanceBits;
+	uint32_t _dwBits;
+	int _nBits;
+};
+
+void CompressorDCL::pack(const byte *src, uint32_t length, int effort)
+{
+	_dest.push_back(_asciiMode ? DCL_ASCII_MODE : DCL_BINARY_MODE);
+	_dest.push_back((byte)_distanceBits);
+
+	uint32_t maxDistance = 64 << _distanceBits;
+	// More effort means following the hash chains further, and looking one byte ahead for a better match.
+	effort = (std::max)(1, (std::min)(9, effort));
+	int maxChain = 2 << effort;
+	bool lazy = (effort >= 5);
+
+	// Hash chains keyed by the next two bytes (which is the shortest match we can code).
+	const uint32_t NoPosition = 0xffffffff;
+	std::vector<uint32_t> head(0x10000, NoPosition);
+	std::vector<uint32_t> previous(length);
+	auto insert = [&](uint32_t pos)
+	{
+		if ((pos + 1) < length)
+		{
+			uint16_t key = src[pos] | (src[pos + 1] << 8);
+			previous[pos] = head[key];
+			head[key] = pos;
+		}
+	};
+	auto findMatch = [&](uint32_t pos, uint32_t &matchDistance) -> uint32_t
+	{
+		uint32_t bestLength = 0;
+		if ((pos + DCL_MIN_MATCH) > length)
+		{
+			return 0;
+		}
+		uint32_t maxLength = (std::min<uint32_t>)(DCL_MAX_MATCH, length - pos);
+		uint16_t key = src[pos] | (src[pos + 1] << 8);
+		uint32_t candidate = head[key];
+		for (int chain = 0; (chain < maxChain) && (candidate != NoPosition); chain++)
+		{
+			uint32_t distance = pos - candidate;
+			if (distance > maxDistance)
+			{
+				break;
+			}
+			// Check the byte that would make this match better first.
+			if ((bestLength < maxLength) && (src[candidate + bestLength] == src[pos + bestLength]))
+			{
+				uint32_t matchLength = DCL_MIN_MATCH;
+				while ((matchLength < maxLength) && (src[candidate + matchLength] == src[pos + matchLength]))
+				{
+					matchLength++;
+				}
+				// Length 2 matches can only reach back 256 bytes.
+				if ((matchLength > bestLength) && ((matchLength > 2) || (distance <= 256)))
+				{
+					bestLength = matchLength;
+					matchDistance = distance;
+					if (matchLength == maxLength)
+					{
+						break;
+					}
+				}
+			}
+			candidate = previous[candidate];
+		}
+		return bestLength;
+	};
+	auto isWorthIt = [&](uint32_t pos, uint32_t matchLength, uint32_t matchDistance)
+	{
+		if (matchLength < DCL_MIN_MATCH)
+		{
+			return false;
+		}
+		if (matchLength > 4)
+		{
+			return true;
+		}
+		int literals = 0;
+		for (uint32_t i = 0; i < matchLength; i++)
+		{
+			literals += literalCost(src[pos + i]);
+		}
+		return matchCost(matchLength, matchDistance) < literals;
+	};
+
+	uint32_t pos = 0;
+	uint32_t matchDistance = 0;
+	uint32_t matchLength = findMatch(pos, matchDistance);
+	while (pos < length)
+	{
+		if (isWorthIt(pos, matchLength, matchDistance))
+		{
+			insert(pos);
+			if (lazy && (matchLength < DCL_MAX_MATCH))
+			{
+				uint32_t nextDistance;
+				uint32_t nextLength = findMatch(pos + 1, nextDistance);
+				if ((nextLength > (matchLength + 1)) && isWorthIt(pos + 1, nextLength, nextDistance))
+				{
+					// Better to write this byte as a literal, and take the longer match.
+					putLiteral(src[pos]);
+					pos++;
+					matchLength = nextLength;
+					matchDistance = nextDistance;
+					continue;
+				}
+			}
+			putMatch(matchLength, matchDistance);
+			for (uint32_t i = 1; i < matchLength; i++)
+			{
+				insert(pos + i);
+			}
+			pos += matchLength;
+		}
+		else
+		{
+			insert(pos);
+			putLiteral(src[pos]);
+			pos++;
+		}
+		matchLength = findMatch(pos, matchDistance);
+	}
+
+	// The decompressor stops when it has everything, but implode streams end with this.
+	putLength(DCL_END_OF_STREAM);
+	flush();
+}
+
+void compressDCL(const byte *src, uint32_t length, std::vector<byte> &dest, bool asciiMode, int effort)
+{
+	dest.clear();
+	// Use the smallest dictionary that covers the data, since that's fewer bits for each distance.
+	int distanceBits = 4;
+	while ((distanceBits < 6) && ((64u << distanceBits) < length))
+	{
+		distanceBits++;
+	}
+	CompressorDCL dcl(dest, asciiMode, distanceBits);
+	dcl.pack(src, length, effort);
+}
@@ -0,0 +1,469 @@
+#include "stdafx.h"
+#include "Codec.h"
+#include <queue>
+
+//
+// Encoders for the SCI0/SCI01 compression methods. Each one produces a stream that the corresponding
+// decoder in Codec.cpp accepts, so they mirror the decoders' state (code widths, token numbering) exactly.
+//
+
+using namespace std;
+
+namespace
+{
+	// Packs codes starting at the least significant bit of each byte (decompressLZW).
+	class LSBBitWriter
+	{
+	public:
+		LSBBitWriter(vector<BYTE> &dest) : _dest(dest), _bits(0), _count(0) {}
+
+		void Write(uint32_t value, int bitCount)
+		{
+			_bits |= value << _count;
+			_count += bitCount;
+			while (_count >= 8)
+			{
+				_dest.push_back((BYTE)_bits);
+				_bits >>= 8;
+				_count -= 8;
+			}
+		}
+
+		void Flush()
+		{
+			if (_count > 0)
+			{
+				_dest.push_back((BYTE)_bits);
+			}
+			_bits = 0;
+			_count = 0;
+		}
+
+	private:
+		vector<BYTE> &_dest;
+		uint32_t _bits;
+		int _count;
+	};
+
+	// Packs codes starting at the most significant bit of each byte (decompressLZW_1, decompressHuffman).
+	class MSBBitWriter
+	{
+	public:
+		MSBBitWriter(vector<BYTE> &dest) : _dest(dest), _bits(0), _count(0) {}
+
+		void Write(uint32_t value, int bitCount)
+		{
+			_bits = (_bits << bitCount) | value;
+			_count += bitCount;
+			while (_count >= 8)
+			{
+				_count -= 8;
+				_dest.push_back((BYTE)(_bits >> _count));
+			}
+			_bits &= (1 << _count) - 1;
+		}
+
+		// For Huffman codes, which can be longer than Write handles.
+		void WriteLong(uint64_t value, int bitCount)
+		{
+			while (bitCount > 16)
+			{
+				bitCount -= 16;
+				Write((uint32_t)(value >> bitCount) & 0xffff, 16);
+			}
+			Write((uint32_t)value & ((1 << bitCount) - 1), bitCount);
+		}
+
+		void Flush()
+		{
+			if (_count > 0)
+			{
+				_dest.push_back((BYTE)(_bits << (8 - _count)));
+			}
+			_bits = 0;
+			_count = 0;
+		}
+
+	private:
+		vector<BYTE> &_dest;
+		uint32_t _bits;
+		int _count;
+	};
+
+	// Maps (prefix token, next byte) to the token for that string. Both LZW variants top out at 4096 tokens.
+	class LZWDictionary
+	{
+	public:
+		LZWDictionary() { Reset(); }
+
+		void Reset()
+		{
+			fill(begin(_keys), end(_keys), EmptyKey);
+		}
+
+		int Find(int prefix, BYTE value) const
+		{
+			uint32_t key = _MakeKey(prefix, value);
+			for (uint32_t slot = _Hash(key); _keys[slot] != EmptyKey; slot = (slot + 1) & (TableSize - 1))
+			{
+				if (_keys[slot] == key)
+				{
+					return _tokens[slot];
+				}
+			}
+			return -1;
+		}
+
+		void Add(int prefix, BYTE value, int token)
+		{
+			uint32_t key = _MakeKey(prefix, value);
+			uint32_t slot = _Hash(key);
+			while (_keys[slot] != EmptyKey)
+			{
+				slot = (slot + 1) & (TableSize - 1);
+			}
+			_keys[slot] = key;
+			_tokens[slot] = (uint16_t)token;
+		}
+
+	private:
+		static const uint32_t TableSize = 8192;	// Keeps the table at most half full.
+		static const uint32_t EmptyKey = 0xffffffff;
+
+		static uint32_t _MakeKey(int prefix, BYTE value) { return ((uint32_t)prefix << 8) | value; }
+		static uint32_t _Hash(uint32_t key) { return (key * 2654435761u) >> (32 - 13); }
+
+		uint32_t _keys[TableSize];
+		uint16_t _tokens[TableSize];
+	};
+}
+
+void compressLZW(const BYTE *src, int length, std::vector<BYTE> &dest)
+{
+	dest.clear();
+	LSBBitWriter writer(dest);
+	unique_ptr<LZWDictionary> dictionary = make_unique<LZWDictionary>();
+
+	// The decoder's state. It registers a token for every code it reads, widening the codes as the
+	// token count reaches the next power of two, until there are 4096 of them.
+	int bitlen = 9;
+	int maxtoken = 0x200;
+	int tokenctr = 0x102;
+
+	if (length > 0)
+	{
+		int current = src[0];
+		for (int i = 1; i <= length; i++)
+		{
+			if (i < length)
+			{
+				int token = dictionary->Find(current, src[i]);
+				if (token != -1)
+				{
+					current = token;
+					continue;
+				}
+			}
+
+			writer.Write(current, bitlen);
+			bool full = (tokenctr == maxtoken) && (bitlen == 12);
+			if (!full)
+			{
+				if (tokenctr == maxtoken)
+				{
+					bitlen++;
+					maxtoken <<= 1;
+				}
+				// The token is the string we just wrote plus the first byte of the next one.
+				if (i < length)
+				{
+					dictionary->Add(current, src[i], tokenctr);
+				}
+				tokenctr++;
+			}
+			else if (i < length)
+			{
+				// Start over, so the tokens adapt to the rest of the data.
+				writer.Write(0x100, bitlen);
+				dictionary->Reset();
+				bitlen = 9;
+				maxtoken = 0x200;
+				tokenctr = 0x102;
+			}
+
+			if (i < length)
+			{
+				current = src[i];
+			}
+		}
+	}
+
+	writer.Write(0x101, bitlen);
+	writer.Flush();
+}
+
+void compressLZW_1(const BYTE *src, int length, std::vector<BYTE> &dest)
+{
+	dest.clear();
+	MSBBitWriter writer(dest);
+	unique_ptr<LZWDictionary> dictionary = make_unique<LZWDictionary>();
+
+	// The decoder's state (see Decrypt3Info). It registers a token for each code after the first, one
+	// code later than we do, and widens the codes one token early.
+	int numbits = 9;
+	int endtoken = 0x1ff;
+	int curtoken = 0x102;
+	bool first = true;
+	// Our own next token.
+	int nextToken = 0x102;
+
+	if (length > 0)
+	{
+		int current = src[0];
+		for (int i = 1; i <= length; i++)
+		{
+			if (i < length)
+			{
+				int token = dictionary->Find(current, src[i]);
+				if (token != -1)
+				{
+					current = token;
+					continue;
+				}
+			}
+
+			writer.Write(current, numbits);
+			if (first)
+			{
+				first = false;
+			}
+			else if (curtoken <= endtoken)
+			{
+				curtoken++;
+				if ((curtoken == endtoken) && (numbits != 12))
+				{
+					numbits++;
+					endtoken = (endtoken << 1) | 1;
+				}
+			}
+
+			if (i < length)
+			{
+				if (nextToken <= 0xfff)
+				{
+					dictionary->Add(current, src[i], nextToken++);
+				}
+				else
+				{
+					writer.Write(0x100, numbits);
+					dictionary->Reset();
+					numbits = 9;
+					endtoken = 0x1ff;
+					curtoken = 0x102;
+					first = true;
+					nextToken = 0x102;
+				}
+				current = src[i];
+			}
+		}
+	}
+
+	writer.Write(0x101, numbits);
+	writer.Flush();
+}
+
+namespace
+{
+	const int EscapeSymbol = 256;
+	// numnodes is a byte, and each coded byte needs a leaf and a branch.
+	const int MaxHuffmanSymbols = 127;
+	// Branches refer to their children with a 4 bit node offset.
+	const int MaxHuffmanNodeOffset = 15;
+
+	struct HuffmanNode
+	{
+		uint32_t Weight;
+		int Symbol;		// -1 for branches
+		int Left;
+		int Right;
+	};
+
+	struct HuffmanCode
+	{
+		uint64_t Bits;
+		int Length;
+	};
+
+	// Builds a tree for the given symbols (the last one being the escape), and returns the index of the root.
+	int _BuildHuffmanTree(const vector<pair<uint32_t, int>> &symbols, vector<HuffmanNode> &nodes)
+	{
+		nodes.clear();
+		typedef pair<uint32_t, int> WeightAndNode;
+		priority_queue<WeightAndNode, vector<WeightAndNode>, greater<WeightAndNode>> queue;
+		for (const auto &symbol : symbols)
+		{
+			queue.emplace(symbol.first, (int)nodes.size());
+			nodes.push_back({ symbol.first, symbol.second, -1, -1 });
+		}
+		while (queue.size() > 1)
+		{
+			WeightAndNode one = queue.top();
+			queue.pop();
+			WeightAndNode two = queue.top();
+			queue.pop();
+			queue.emplace(one.first + two.first, (int)nodes.size());
+			nodes.push_back({ one.first + two.first, -1, one.second, two.second });
+		}
+		return queue.top().second;
+	}
+
+	void _GetHuffmanCodes(const vector<HuffmanNode> &nodes, int index, uint64_t bits, int length, HuffmanCode *codes)
+	{
+		const HuffmanNode &node = nodes[index];
+		if (node.Symbol == -1)
+		{
+			_GetHuffmanCodes(nodes, node.Left, bits << 1, length + 1, codes);
+			_GetHuffmanCodes(nodes, node.Right, (bits << 1) | 1, length + 1, codes);
+		}
+		else
+		{
+			codes[node.Symbol] = { bits, length };
+		}
+	}
+
+	// Lays the tree out breadth first, which keeps children close to their parents. Returns false if a
+	// child ends up too far away. The escape isn't a node: it's a right branch with an offset of 0.
+	bool _LayOutHuffmanTree(vector<HuffmanNode> &nodes, int root, vector<BYTE> &layout)
+	{
+		vector<int> order;
+		vector<int> position(nodes.size());
+		order.push_back(root);
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			HuffmanNode &node = nodes[order[i]];
+			if (node.Symbol == -1)
+			{
+				if (nodes[node.Left].Symbol == EscapeSymbol)
+				{
+					swap(node.Left, node.Right);
+				}
+				order.push_back(node.Left);
+				if (nodes[node.Right].Symbol != EscapeSymbol)
+				{
+					order.push_back(node.Right);
+				}
+			}
+		}
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			position[order[i]] = (int)i;
+		}
+
+		layout.clear();
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			const HuffmanNode &node = nodes[order[i]];
+			if (node.Symbol == -1)
+			{
+				int leftOffset = position[node.Left] - (int)i;
+				int rightOffset = (nodes[node.Right].Symbol == EscapeSymbol) ? 0 : (position[node.Right] - (int)i);
+				if ((leftOffset > MaxHuffmanNodeOffset) || (rightOffset > MaxHuffmanNodeOffset))
+				{
+					return false;
+				}
+				layout.push_back(0);
+				layout.push_back((BYTE)((leftOffset << 4) | rightOffset));
+			}
+			else
+			{
+				layout.push_back((BYTE)node.Symbol);
+				layout.push_back(0);
+			}
+		}
+		return true;
+	}
+}
+
+void compressHuffman(const BYTE *src, int length, std::vector<BYTE> &dest)
+{
+	dest.clear();
+
+	uint32_t counts[256] = {};
+	for (int i = 0; i < length; i++)
+	{
+		counts[src[i]]++;
+	}
+	vector<pair<uint32_t, int>> byFrequency;
+	for (int i = 0; i < 256; i++)
+	{
+		if (counts[i])
+		{
+			byFrequency.emplace_back(counts[i], i);
+		}
+	}
+	sort(byFrequency.begin(), byFrequency.end(), greater<pair<uint32_t, int>>());
+	if (byFrequency.empty())
+	{
+		byFrequency.emplace_back(0, 0);
+	}
+
+	// Only the most common bytes get their own leaf. The rest are written as an escape followed by the
+	// byte. The stream ends with an escaped terminator, so we pick a byte that has a leaf for that (any
+	// escaped occurrences of it would end the stream early).
+	BYTE terminator = (BYTE)byFrequency[0].second;
+	uint64_t bestBits = (numeric_limits<uint64_t>::max)();
+	vector<BYTE> bestLayout;
+	HuffmanCode codes[257] = {};
+	int symbolLimit = min((int)byFrequency.size(), MaxHuffmanSymbols);
+	vector<HuffmanNode> nodes;
+	vector<BYTE> layout;
+	for (int symbolCount = 1; symbolCount <= symbolLimit; symbolCount++)
+	{
+		vector<pair<uint32_t, int>> symbols(byFrequency.begin(), byFrequency.begin() + symbolCount);
+		uint32_t escapeWeight = 1;
+		for (size_t i = symbolCount; i < byFrequency.size(); i++)
+		{
+			escapeWeight += byFrequency[i].first;
+		}
+		symbols.emplace_back(escapeWeight, EscapeSymbol);
+
+		int root = _BuildHuffmanTree(symbols, nodes);
+		HuffmanCode candidateCodes[257] = {};
+		_GetHuffmanCodes(nodes, root, 0, 0, candidateCodes);
+		uint64_t bits = (uint64_t)escapeWeight * (candidateCodes[EscapeSymbol].Length + 8);
+		for (int i = 0; i < symbolCount; i++)
+		{
+			bits += (uint64_t)symbols[i].first * candidateCodes[symbols[i].second].Length;
+		}
+		bits += (uint64_t)symbolCount * 2 * 2 * 8;	// The tree
+		if ((bits < bestBits) && _LayOutHuffmanTree(nodes, root, layout))
+		{
+			// Laying out may have swapped the escape onto the right, so get the codes again.
+			fill(begin(codes), end(codes), HuffmanCode());
+			_GetHuffmanCodes(nodes, root, 0, 0, codes);
+			bestBits = bits;
+			bestLayout = layout;
+		}
+	}
+
+	dest.push_back((BYTE)(bestLayout.size() / 2));
+	dest.push_back(terminator);
+	dest.insert(dest.end(), bestLayout.begin(), bestLayout.end());
+	MSBBitWriter writer(dest);
+	for (int i = 0; i < length; i++)
+	{
+		const HuffmanCode &code = codes[src[i]];
+		if (code.Length)
+		{
+			writer.WriteLong(code.Bits, code.Length);
+		}
+		else
+		{
+			writer.WriteLong(codes[EscapeSymbol].Bits, codes[EscapeSymbol].Length);
+			writer.Write(src[i], 8);
+		}
+	}
+	writer.WriteLong(codes[EscapeSymbol].Bits, codes[EscapeSymbol].Length);
+	writer.Write(terminator, 8);
+	writer.Flush();
+}
@@ -50,31 +50,32 @@ void ExtractAllResources(SCIVersion version, const std::string &destinationFolde
 		}
 	}
 
+	// Only the headers are needed to figure out how much work there is.
 	int totalCount = 0;
 	auto resourceContainer = appState->GetResourceMap().Resources(ResourceTypeFlags::All, ResourceEnumFlags::MostRecentOnly | ResourceEnumFlags::ExcludePatchFiles);
-	for (auto &blob : *resourceContainer)
+	for (const ResourceHeaderRecord &record : resourceContainer->Headers())
 	{
 		if (extractResources)
 		{
 			totalCount++;
 		}
-		if (extractViewImages && (blob->GetType() == ResourceType::View))
+		if (extractViewImages && (record.Type == ResourceType::View))
 		{
 			totalCount++;
 		}
-		if (extractPicImages && (blob->GetType() == ResourceType::Pic))
+		if (extractPicImages && (record.Type == ResourceType::Pic))
 		{
 			totalCount++;
 		}
-		if (disassembleScripts && (blob->GetType() == ResourceType::Pic))
+		if (disassembleScripts && (record.Type == ResourceType::Pic))
 		{
 			totalCount++;
 		}
-		if (extractMessages && (blob->GetType() == ResourceType::Message))
+		if (extractMessages && (record.Type == ResourceType::Message))
 		{
 			totalCount++;
 		}
-		if (generateWavs && (blob->GetType() == ResourceType::Audio))
+		if (generateWavs && (record.Type == ResourceType::Audio))
 		{
 			totalCount++;
 		}
@@ -84,9 +85,9 @@ void ExtractAllResources(SCIVersion version, const std::string &destinationFolde
 	if (generateWavs || extractResources)
 	{
 		resourceContainer = appState->GetResourceMap().Resources(ResourceTypeFlags::AudioMap, ResourceEnumFlags::MostRecentOnly | ResourceEnumFlags::ExcludePatchFiles);
-		for (auto &blob : *resourceContainer)
+		for (const ResourceHeaderRecord &record : resourceContainer->Headers())
 		{
-			if (blob->GetNumber() != version.AudioMapResourceNumber)
+			if (record.GetNumber() != version.AudioMapResourceNumber)
 			{
 				totalCount++;
 				if (generateWavs)
@@ -0,0 +1,371 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#include "stdafx.h"
+#include "MappedFile.h"
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+MappedFileCache g_mappedFileCache;
+
+namespace
+{
+#ifdef _WIN32
+	bool _GetIdentity(const string &filename, uint64_t &size, uint64_t &lastWriteTime)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (!GetFileAttributesEx(filename.c_str(), GetFileExInfoStandard, &attributes))
+		{
+			return false;
+		}
+		size = ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+		lastWriteTime = ((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+		return true;
+	}
+
+	class PlatformFile
+	{
+	public:
+		PlatformFile(const string &filename) : _filename(filename)
+		{
+			_hFile = CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (_hFile == INVALID_HANDLE_VALUE)
+			{
+				throw std::exception(GetMessageFromLastError("Opening " + filename).c_str());
+			}
+		}
+
+		~PlatformFile()
+		{
+			CloseHandle(_hFile);
+		}
+
+		uint64_t GetSize()
+		{
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(_hFile, &size))
+			{
+				throw std::exception(GetMessageFromLastError(_filename).c_str());
+			}
+			return (uint64_t)size.QuadPart;
+		}
+
+		const uint8_t *Map(uint32_t size)
+		{
+			HANDLE hMap = CreateFileMapping(_hFile, nullptr, PAGE_READONLY, 0, size, nullptr);
+			if (hMap == nullptr)
+			{
+				throw std::exception(GetMessageFromLastError(_filename).c_str());
+			}
+			const uint8_t *data = reinterpret_cast<const uint8_t*>(MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, size));
+			// The view keeps the mapping alive.
+			CloseHandle(hMap);
+			if (data == nullptr)
+			{
+				throw std::exception(GetMessageFromLastError(_filename).c_str());
+			}
+			return data;
+		}
+
+		void Read(uint8_t *data, uint32_t size)
+		{
+			DWORD cbRead;
+			if (!ReadFile(_hFile, data, size, &cbRead, nullptr) || (cbRead != size))
+			{
+				throw std::exception("Unable to read file data.");
+			}
+		}
+
+		static void Unmap(const uint8_t *data, uint32_t size)
+		{
+			BOOL result = UnmapViewOfFile(data);
+			assert(result);
+		}
+
+	private:
+		string _filename;
+		HANDLE _hFile;
+	};
+#else
+	bool _GetIdentity(const string &filename, uint64_t &size, uint64_t &lastWriteTime)
+	{
+		struct stat info;
+		if (stat(filename.c_str(), &info) == -1)
+		{
+			return false;
+		}
+		size = (uint64_t)info.st_size;
+		lastWriteTime = ((uint64_t)info.st_mtim.tv_sec * 1000000000) + info.st_mtim.tv_nsec;
+		return true;
+	}
+
+	class PlatformFile
+	{
+	public:
+		PlatformFile(const string &filename) : _filename(filename)
+		{
+			_fd = open(filename.c_str(), O_RDONLY);
+			if (_fd == -1)
+			{
+				throw std::runtime_error("Opening " + filename + ": " + strerror(errno));
+			}
+		}
+
+		~PlatformFile()
+		{
+			close(_fd);
+		}
+
+		uint64_t GetSize()
+		{
+			struct stat info;
+			if (fstat(_fd, &info) == -1)
+			{
+				throw std::runtime_error(_filename + ": " + strerror(errno));
+			}
+			return (uint64_t)info.st_size;
+		}
+
+		const uint8_t *Map(uint32_t size)
+		{
+			void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, _fd, 0);
+			if (data == MAP_FAILED)
+			{
+				throw std::runtime_error(_filename + ": " + strerror(errno));
+			}
+			return reinterpret_cast<const uint8_t*>(data);
+		}
+
+		void Read(uint8_t *data, uint32_t size)
+		{
+			while (size > 0)
+			{
+				ssize_t cbRead = read(_fd, data, size);
+				if (cbRead <= 0)
+				{
+					throw std::runtime_error("Unable to read file data.");
+				}
+				data += cbRead;
+				size -= (uint32_t)cbRead;
+			}
+		}
+
+		static void Unmap(const uint8_t *data, uint32_t size)
+		{
+			munmap(const_cast<uint8_t*>(data), size);
+		}
+
+	private:
+		string _filename;
+		int _fd;
+	};
+#endif
+}
+
+MappedFile::MappedFile(const string &filename, const uint8_t *data, uint32_t size, unique_ptr<uint8_t[]> copy) :
+	_filename(filename), _data(data), _size(size), _copy(move(copy)) {}
+
+MappedFile::~MappedFile()
+{
+	if (_data && !_copy)
+	{
+		PlatformFile::Unmap(_data, _size);
+	}
+}
+
+MappedFileCache::MappedFileCache() : _budget(DefaultBudget), _cachedBytes(0), _stats() {}
+
+string MappedFileCache::_MakeKey(const string &filename, MappedFileMode mode)
+{
+	string key = filename;
+	transform(key.begin(), key.end(), key.begin(), ::tolower);
+	key += (mode == MappedFileMode::Map) ? "|map" : "|copy";
+	return key;
+}
+
+shared_ptr<const MappedFile> MappedFileCache::_Load(const string &filename, MappedFileMode mode)
+{
+	PlatformFile file(filename);
+	uint64_t size = file.GetSize();
+	if (size > (numeric_limits<uint32_t>::max)())
+	{
+		throw std::exception("File too large.");
+	}
+	uint32_t size32 = (uint32_t)size;
+
+	// Empty files can't be mapped, but there's nothing to read anyway.
+	const uint8_t *data = nullptr;
+	unique_ptr<uint8_t[]> copy;
+	if (size32 > 0)
+	{
+		if (mode == MappedFileMode::Map)
+		{
+			data = file.Map(size32);
+		}
+		else
+		{
+			// Don't use make_unique, because it will zero init the array (perf).
+			copy.reset(new uint8_t[size32]);
+			file.Read(copy.get(), size32);
+			data = copy.get();
+		}
+	}
+	return shared_ptr<const MappedFile>(new MappedFile(filename, data, size32, move(copy)));
+}
+
+shared_ptr<const MappedFile> MappedFileCache::Open(const string &filename, MappedFileMode mode)
+{
+	string key = _MakeKey(filename, mode);
+	FileIdentity identity;
+	if (!_GetIdentity(filename, identity.Size, identity.LastWriteTime))
+	{
+		throw std::exception(("Unable to open " + filename).c_str());
+	}
+
+	{
+		lock_guard<mutex> lock(_mutex);
+		auto it = _entries.find(key);
+		if (it != _entries.end())
+		{
+			Entry &entry = it->second;
+			shared_ptr<const MappedFile> existing = entry.File.lock();
+			if (existing && (entry.Identity == identity))
+			{
+				_stats.Hits++;
+				_RemoveFromLru(entry);
+				_AddToLru(key, entry, existing);
+				_EnforceBudget();
+				return existing;
+			}
+			// The file changed (or nobody is using it anymore). Anyone still holding the old one keeps it.
+			_RemoveFromLru(entry);
+			_entries.erase(it);
+		}
+		_stats.Misses++;
+	}
+
+	// Load outside the lock, so we don't hold up everyone else. If another thread loads the same
+	// file at the same time, the first one in wins.
+	shared_ptr<const MappedFile> file = _Load(filename, mode);
+
+	lock_guard<mutex> lock(_mutex);
+	auto result = _entries.emplace(key, Entry());
+	Entry &entry = result.first->second;
+	if (!result.second)
+	{
+		shared_ptr<const MappedFile> existing = entry.File.lock();
+		if (existing && (entry.Identity == identity))
+		{
+			return existing;
+		}
+		_RemoveFromLru(entry);
+	}
+	entry.Identity = identity;
+	entry.File = file;
+	entry.InLru = false;
+	_AddToLru(key, entry, file);
+	_EnforceBudget();
+	return file;
+}
+
+void MappedFileCache::_RemoveFromLru(Entry &entry)
+{
+	if (entry.InLru)
+	{
+		_cachedBytes -= entry.LruPosition->File->GetSize();
+		_lru.erase(entry.LruPosition);
+		entry.InLru = false;
+	}
+}
+
+void MappedFileCache::_AddToLru(const string &key, Entry &entry, const shared_ptr<const MappedFile> &file)
+{
+	assert(!entry.InLru);
+	_lru.push_front({ key, file });
+	entry.LruPosition = _lru.begin();
+	entry.InLru = true;
+	_cachedBytes += file->GetSize();
+}
+
+void MappedFileCache::_EnforceBudget()
+{
+	while ((_cachedBytes > _budget) && !_lru.empty())
+	{
+		// The evicted file stays shared (through the weak reference) for as long as someone else is using it.
+		Entry &entry = _entries.at(_lru.back().Key);
+		_RemoveFromLru(entry);
+		_stats.Evictions++;
+	}
+
+	// Forget about files nobody is using anymore.
+	for (auto it = _entries.begin(); it != _entries.end(); )
+	{
+		if (!it->second.InLru && it->second.File.expired())
+		{
+			it = _entries.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void MappedFileCache::Invalidate(const string &filename)
+{
+	lock_guard<mutex> lock(_mutex);
+	for (MappedFileMode mode : { MappedFileMode::Map, MappedFileMode::Copy })
+	{
+		auto it = _entries.find(_MakeKey(filename, mode));
+		if (it != _entries.end())
+		{
+			_RemoveFromLru(it->second);
+			_entries.erase(it);
+		}
+	}
+}
+
+void MappedFileCache::Clear()
+{
+	lock_guard<mutex> lock(_mutex);
+	_entries.clear();
+	_lru.clear();
+	_cachedBytes = 0;
+}
+
+void MappedFileCache::SetBudget(uint64_t bytes)
+{
+	lock_guard<mutex> lock(_mutex);
+	_budget = bytes;
+	_EnforceBudget();
+}
+
+MappedFileCacheStats MappedFileCache::GetStats()
+{
+	lock_guard<mutex> lock(_mutex);
+	MappedFileCacheStats stats = _stats;
+	stats.CachedBytes = _cachedBytes;
+	return stats;
+}
+
+void MappedFileCache::ResetStats()
+{
+	lock_guard<mutex> lock(_mutex);
+	_stats = MappedFileCacheStats();
+}
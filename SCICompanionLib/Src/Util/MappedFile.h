@@ -0,0 +1,123 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#pragma once
+
+enum class MappedFileMode
+{
+	// A read-only memory mapped view. Pages are only read from disk when they're touched. On Windows, the
+	// file can be appended to while it's mapped, but can't be deleted, truncated or replaced.
+	Map,
+	// The whole file is read into memory. For small files that get replaced often (e.g. resource maps).
+	Copy,
+};
+
+//
+// The read-only contents of an entire file. Get these from g_mappedFileCache.
+//
+class MappedFile
+{
+public:
+	MappedFile(const MappedFile &src) = delete;
+	MappedFile &operator=(const MappedFile &src) = delete;
+	~MappedFile();
+
+	const uint8_t *GetData() const { return _data; }
+	uint32_t GetSize() const { return _size; }
+	const std::string &GetFilename() const { return _filename; }
+
+private:
+	friend class MappedFileCache;
+	MappedFile(const std::string &filename, const uint8_t *data, uint32_t size, std::unique_ptr<uint8_t[]> copy);
+
+	std::string _filename;
+	const uint8_t *_data;
+	uint32_t _size;
+	std::unique_ptr<uint8_t[]> _copy;	// Only for MappedFileMode::Copy
+};
+
+struct MappedFileCacheStats
+{
+	uint64_t Hits;
+	uint64_t Misses;
+	uint64_t Evictions;
+	uint64_t CachedBytes;	// What the cache itself is keeping alive.
+};
+
+//
+// Process-wide cache of file contents, keyed by path, so that resource sources (which come and go with
+// each ResourceContainer) don't re-open and re-read the same volumes and maps.
+//
+// Anyone who has a file open shares the same MappedFile, for as long as the file doesn't change (size and
+// last write time). In addition, the cache keeps the most recently used files alive up to a byte budget.
+//
+// Before replacing or deleting a file, call Invalidate so the cache lets go of it. Other holders need to
+// let go of their references too (on Windows, a file can't be deleted while it's mapped).
+//
+class MappedFileCache
+{
+public:
+	static const uint64_t DefaultBudget = 64 * 1024 * 1024;
+
+	MappedFileCache();
+	MappedFileCache(const MappedFileCache &src) = delete;
+	MappedFileCache &operator=(const MappedFileCache &src) = delete;
+
+	// Throws if the file can't be opened or read.
+	std::shared_ptr<const MappedFile> Open(const std::string &filename, MappedFileMode mode = MappedFileMode::Map);
+
+	void Invalidate(const std::string &filename);
+	void Clear();
+
+	void SetBudget(uint64_t bytes);
+	MappedFileCacheStats GetStats();
+	void ResetStats();
+
+private:
+	struct FileIdentity
+	{
+		uint64_t Size;
+		uint64_t LastWriteTime;
+
+		bool operator==(const FileIdentity &other) const { return (Size == other.Size) && (LastWriteTime == other.LastWriteTime); }
+	};
+	struct LruItem
+	{
+		std::string Key;
+		std::shared_ptr<const MappedFile> File;
+	};
+	typedef std::list<LruItem> LruList;
+
+	struct Entry
+	{
+		FileIdentity Identity;
+		std::weak_ptr<const MappedFile> File;
+		bool InLru;
+		LruList::iterator LruPosition;
+	};
+
+	static std::string _MakeKey(const std::string &filename, MappedFileMode mode);
+	static std::shared_ptr<const MappedFile> _Load(const std::string &filename, MappedFileMode mode);
+	void _RemoveFromLru(Entry &entry);
+	void _AddToLru(const std::string &key, Entry &entry, const std::shared_ptr<const MappedFile> &file);
+	void _EnforceBudget();
+
+	std::mutex _mutex;
+	std::unordered_map<std::string, Entry> _entries;
+	LruList _lru;		// Most recently used at the front.
+	uint64_t _budget;
+	uint64_t _cachedBytes;
+	MappedFileCacheStats _stats;
+};
+
+extern MappedFileCache g_mappedFileCache;
@@ -0,0 +1,132 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#include "stdafx.h"
+#include "PngWriter.h"
+
+using namespace std;
+
+namespace
+{
+	struct CrcTable
+	{
+		CrcTable()
+		{
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+				}
+				Values[n] = c;
+			}
+		}
+		uint32_t Values[256];
+	};
+
+	uint32_t _Crc(const uint8_t *data, size_t size, uint32_t crc = 0)
+	{
+		static const CrcTable table;
+		crc ^= 0xffffffff;
+		for (size_t i = 0; i < size; i++)
+		{
+			crc = table.Values[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+		}
+		return crc ^ 0xffffffff;
+	}
+
+	void _PushBigEndian(vector<uint8_t> &out, uint32_t value)
+	{
+		out.push_back((uint8_t)(value >> 24));
+		out.push_back((uint8_t)(value >> 16));
+		out.push_back((uint8_t)(value >> 8));
+		out.push_back((uint8_t)value);
+	}
+
+	void _WriteChunk(vector<uint8_t> &out, const char *type, const vector<uint8_t> &data)
+	{
+		_PushBigEndian(out, (uint32_t)data.size());
+		size_t typeOffset = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		_PushBigEndian(out, _Crc(&out[typeOffset], out.size() - typeOffset));
+	}
+}
+
+void EncodePng8(const uint8_t *bits, int cx, int cy, bool bottomUp, const RGBQUAD *palette, int paletteCount, vector<uint8_t> &out)
+{
+	static const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	out.assign(signature, signature + sizeof(signature));
+
+	vector<uint8_t> header;
+	_PushBigEndian(header, (uint32_t)cx);
+	_PushBigEndian(header, (uint32_t)cy);
+	header.push_back(8);	// Bit depth
+	header.push_back(3);	// Palettized
+	header.push_back(0);	// Deflate
+	header.push_back(0);	// Adaptive filtering (we always use "none")
+	header.push_back(0);	// No interlace
+	_WriteChunk(out, "IHDR", header);
+
+	vector<uint8_t> colors;
+	colors.reserve(paletteCount * 3);
+	for (int i = 0; i < paletteCount; i++)
+	{
+		colors.push_back(palette[i].rgbRed);
+		colors.push_back(palette[i].rgbGreen);
+		colors.push_back(palette[i].rgbBlue);
+	}
+	_WriteChunk(out, "PLTE", colors);
+
+	// Each row is preceded by its filter type.
+	vector<uint8_t> rows;
+	rows.reserve((cx + 1) * cy);
+	for (int y = 0; y < cy; y++)
+	{
+		const uint8_t *row = bits + (bottomUp ? (cy - 1 - y) : y) * cx;
+		rows.push_back(0);
+		rows.insert(rows.end(), row, row + cx);
+	}
+
+	// A zlib stream of stored deflate blocks.
+	const size_t MaxStoredBlock = 0xffff;
+	vector<uint8_t> compressed;
+	compressed.reserve(rows.size() + (rows.size() / MaxStoredBlock + 1) * 5 + 6);
+	compressed.push_back(0x78);
+	compressed.push_back(0x01);
+	size_t offset = 0;
+	do
+	{
+		size_t blockSize = (min)(MaxStoredBlock, rows.size() - offset);
+		bool final = (offset + blockSize) == rows.size();
+		compressed.push_back(final ? 1 : 0);
+		compressed.push_back((uint8_t)blockSize);
+		compressed.push_back((uint8_t)(blockSize >> 8));
+		compressed.push_back((uint8_t)~blockSize);
+		compressed.push_back((uint8_t)(~blockSize >> 8));
+		compressed.insert(compressed.end(), rows.begin() + offset, rows.begin() + offset + blockSize);
+		offset += blockSize;
+	} while (offset < rows.size());
+
+	uint32_t a = 1, b = 0;
+	for (uint8_t value : rows)
+	{
+		a = (a + value) % 65521;
+		b = (b + a) % 65521;
+	}
+	_PushBigEndian(compressed, (b << 16) | a);
+	_WriteChunk(out, "IDAT", compressed);
+
+	_WriteChunk(out, "IEND", vector<uint8_t>());
+}
@@ -0,0 +1,24 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#pragma once
+
+//
+// Encodes an 8 bit palettized image as a PNG, without going through GDI+.
+// The image data is stored uncompressed (deflate "stored" blocks), since we don't have a deflate
+// encoder. That keeps it simple and fast, and the files are still lossless and readable by anything.
+//
+// bits is cx * cy bytes (no padding). If bottomUp is true, the first row in bits is the bottom one
+// (like our pic screens and DIBs).
+//
+void EncodePng8(const uint8_t *bits, int cx, int cy, bool bottomUp, const RGBQUAD *palette, int paletteCount, std::vector<uint8_t> &out);
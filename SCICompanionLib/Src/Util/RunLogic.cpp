@@ -14,6 +14,7 @@
 #include "stdafx.h"
 #include "RunLogic.h"
 #include "format.h"
+#include "GameIniCache.h"
 
 static const char c_szExeProfileKey[] = "ExeProfile";	// Defaults to Other
 
@@ -166,7 +167,9 @@ bool RunLogic::RunGame(std::string &error, HANDLE &hProcess)
 
 bool RunLogic::_WriteProfileString(const std::string &key, const std::string &value)
 {
-	return !!WritePrivateProfileString(c_szGameSection, key.c_str(), value.c_str(), _gameIni.c_str());
+	bool success = !!WritePrivateProfileString(c_szGameSection, key.c_str(), value.c_str(), _gameIni.c_str());
+	g_gameIniCache.Invalidate(_gameIni);
+	return success;
 }
 
 std::string RunLogic::_ReadProfileString(const std::string &key, const std::string &defaultValue)
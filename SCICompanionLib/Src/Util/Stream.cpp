@@ -14,6 +14,7 @@
 #include "stdafx.h"
 #include "Stream.h"
 #include "PerfTimer.h"
+#include "MappedFile.h"
 
 namespace sci
 {
@@ -338,14 +339,14 @@ namespace sci
 		return istream(src.GetInternalPointer(), src.tellp());
 	}
 
-	streamOwner::streamOwner(const uint8_t *data, uint32_t size) : _dataMemoryMapped(nullptr), _hMap(nullptr), _hFile(INVALID_HANDLE_VALUE)
+	streamOwner::streamOwner(const uint8_t *data, uint32_t size)
 	{
 		_pData = std::make_unique<uint8_t[]>(size);
 		_cbSizeValid = size;
 		memcpy(_pData.get(), data, size);
 	}
 
-	streamOwner::streamOwner(HANDLE hFile, DWORD lengthToInclude) : _dataMemoryMapped(nullptr), _hMap(nullptr), _hFile(INVALID_HANDLE_VALUE)
+	streamOwner::streamOwner(HANDLE hFile, DWORD lengthToInclude) : _cbSizeValid(0)
 	{
 		DWORD dwSizeHigh = 0;
 		// Start from the current position:
@@ -392,55 +393,34 @@ namespace sci
 	}
 
 
-	streamOwner::streamOwner(const std::string &filename) : _dataMemoryMapped(nullptr), _hMap(nullptr), _cbSizeValid(0), _pData(nullptr)
+	streamOwner::streamOwner(const std::string &filename) : _cbSizeValid(0)
 	{
-		_hFile = CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
-		if (_hFile != INVALID_HANDLE_VALUE)
+		try
 		{
-			// If no length specifies, then until the end of the file.
-			DWORD dwSizeHigh;
-			DWORD dwSize = GetFileSize(_hFile, &dwSizeHigh);
-			if (dwSize != INVALID_FILE_SIZE)
-			{
-				assert(dwSizeHigh == 0);
-				_hMap = CreateFileMapping(_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
-				if (_hMap != nullptr)
-				{
-					_dataMemoryMapped = reinterpret_cast<uint8_t*>(MapViewOfFile(_hMap, FILE_MAP_READ, 0, 0, 0));
-					if (_dataMemoryMapped)
-					{
-						_cbSizeValid = dwSize;
-					}
-				}
-			}
+			_mappedFile = g_mappedFileCache.Open(filename);
+			_cbSizeValid = _mappedFile->GetSize();
+		}
+		catch (std::exception)
+		{
+			// Callers check for an empty stream.
 		}
 	}
 
-	streamOwner::~streamOwner()
+	streamOwner::streamOwner(std::shared_ptr<const MappedFile> mappedFile) : _cbSizeValid(mappedFile->GetSize()), _mappedFile(mappedFile)
 	{
-		if (_dataMemoryMapped)
-		{
-			BOOL result = UnmapViewOfFile(_dataMemoryMapped);
-			assert(result);
-		}
-		if (_hMap)
-		{
-			CloseHandle(_hMap);
-		}
-		if (_hFile != INVALID_HANDLE_VALUE)
-		{
-			CloseHandle(_hFile);
-		}
+	}
 
+	streamOwner::~streamOwner()
+	{
 	}
 
 	uint32_t streamOwner::GetDataSize() { return _cbSizeValid; }
 
 	istream streamOwner::getReader()
 	{
-		if (_dataMemoryMapped)
+		if (_mappedFile)
 		{
-			return istream(_dataMemoryMapped, _cbSizeValid);
+			return istream(_mappedFile->GetData(), _cbSizeValid);
 		}
 		else
 		{
@@ -13,6 +13,8 @@
 ***************************************************************************/
 #pragma once
 
+class MappedFile;
+
 namespace sci
 {
 	// STL doesn't have a memory stream (other than stringstream), so we'll implement our own
@@ -141,7 +143,8 @@ namespace sci
 	public:
 		streamOwner(const uint8_t *data, uint32_t size);
 		streamOwner(HANDLE hFile, DWORD lengthToInclude = 0);
-		streamOwner(const std::string &filename);   // Memory mapped
+		streamOwner(const std::string &filename);   // Memory mapped (empty if the file can't be opened)
+		streamOwner(std::shared_ptr<const MappedFile> mappedFile);
 		~streamOwner();
 		istream getReader();
 		uint32_t GetDataSize();
@@ -150,9 +153,7 @@ namespace sci
 		std::unique_ptr<uint8_t[]> _pData;		// Our data
 		uint32_t _cbSizeValid;
 
-		const uint8_t *_dataMemoryMapped;
-		HANDLE _hFile;
-		HANDLE _hMap;
+		std::shared_ptr<const MappedFile> _mappedFile;
 	};
 
 	void transfer(istream from, ostream &to, uint32_t count);
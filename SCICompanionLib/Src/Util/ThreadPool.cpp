@@ -0,0 +1,77 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#include "stdafx.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+size_t ThreadPool::GetDefaultThreadCount()
+{
+	// hardware_concurrency can return 0 if it doesn't know.
+	return max(1u, thread::hardware_concurrency());
+}
+
+ThreadPool::ThreadPool(size_t threadCount) : _stopping(false)
+{
+	if (threadCount == 0)
+	{
+		threadCount = GetDefaultThreadCount();
+	}
+	for (size_t i = 0; i < threadCount; i++)
+	{
+		_threads.emplace_back(&ThreadPool::_WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_condition.notify_all();
+	for (thread &worker : _threads)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::_Enqueue(std::function<void()> work)
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+		_work.push_back(move(work));
+	}
+	_condition.notify_one();
+}
+
+void ThreadPool::_WorkerLoop()
+{
+	while (true)
+	{
+		function<void()> work;
+		{
+			unique_lock<mutex> lock(_mutex);
+			_condition.wait(lock, [this]() { return _stopping || !_work.empty(); });
+			if (_work.empty())
+			{
+				// Only get here if we're stopping.
+				return;
+			}
+			work = move(_work.front());
+			_work.pop_front();
+		}
+		work();
+	}
+}
@@ -0,0 +1,58 @@
+/***************************************************************************
+	Copyright (c) 2020 Philip Fortier
+
+	This program is free software; you can redistribute it and/or
+	modify it under the terms of the GNU General Public License
+	as published by the Free Software Foundation; either version 2
+	of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+***************************************************************************/
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+
+//
+// A fixed set of worker threads that run submitted work in FIFO order.
+// Exceptions thrown by the work are delivered through the returned future.
+//
+// The destructor finishes any work that has already been submitted.
+//
+class ThreadPool
+{
+public:
+	// threadCount of 0 means one per hardware thread.
+	ThreadPool(size_t threadCount = 0);
+	~ThreadPool();
+	ThreadPool(const ThreadPool &src) = delete;
+	ThreadPool &operator=(const ThreadPool &src) = delete;
+
+	template<typename _TFunc>
+	auto Submit(_TFunc func) -> std::future<decltype(func())>
+	{
+		typedef decltype(func()) _TResult;
+		auto task = std::make_shared<std::packaged_task<_TResult()>>(std::move(func));
+		std::future<_TResult> result = task->get_future();
+		_Enqueue([task]() { (*task)(); });
+		return result;
+	}
+
+	size_t GetThreadCount() const { return _threads.size(); }
+
+	static size_t GetDefaultThreadCount();
+
+private:
+	void _Enqueue(std::function<void()> work);
+	void _WorkerLoop();
+
+	std::vector<std::thread> _threads;
+	std::deque<std::function<void()>> _work;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	bool _stopping;
+};
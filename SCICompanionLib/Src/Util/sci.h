@@ -151,6 +151,8 @@ static const uint32_t NoBase36 = 0xffffffff;
 
 std::string GetGameIniFileName(const std::string &gameFolder);
 std::string FigureOutResourceName(const std::string &iniFileName, ResourceType type, int iNumber, uint32_t base36Number);
+class GameIniTable;
+std::string FigureOutResourceName(const GameIniTable &iniTable, ResourceType type, int iNumber, uint32_t base36Number);
 
 const TCHAR *g_rgszTypeToSectionName[];
 
@@ -190,6 +192,10 @@ struct ScopedFile : public ScopedHandle
 	void Write(const uint8_t *data, uint32_t length);
 	uint32_t GetLength();
 	uint32_t SeekToEnd();
+	void Flush();
+	void Truncate(uint32_t length);
+	// Returns the number of bytes read, which is less than length if we hit the end of the file.
+	uint32_t ReadAt(uint32_t position, uint8_t *data, uint32_t length);
 
 	std::string filename;
 };
@@ -552,6 +558,7 @@ BOOL OpenResource(const ResourceBlob *pData, bool setModifier = false);
 int ResourceNumberFromFileName(PCTSTR pszFileName);
 void deletefile(const std::string &filename);
 void movefile(const std::string &from, const std::string &to);
+void replacefile(const std::string &from, const std::string &to);
 void testopenforwrite(const std::string &filename);
 uint32_t GetResourceOffsetInFile(uint8_t secondHeaderByte);
 extern const TCHAR g_szResourceSpec[];
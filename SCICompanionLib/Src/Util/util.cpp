@@ -995,6 +995,38 @@ uint32_t ScopedFile::SeekToEnd()
 	return position;
 }
 
+void ScopedFile::Flush()
+{
+	if (!FlushFileBuffers(hFile))
+	{
+		std::string details = "Flushing ";
+		details += filename;
+		throw std::exception(GetMessageFromLastError(details).c_str());
+	}
+}
+
+void ScopedFile::Truncate(uint32_t length)
+{
+	if ((SetFilePointer(hFile, length, nullptr, FILE_BEGIN) == INVALID_SET_FILE_POINTER) || !SetEndOfFile(hFile))
+	{
+		std::string details = "Truncating ";
+		details += filename;
+		throw std::exception(GetMessageFromLastError(details).c_str());
+	}
+}
+
+uint32_t ScopedFile::ReadAt(uint32_t position, uint8_t *data, uint32_t length)
+{
+	DWORD cbRead = 0;
+	if ((SetFilePointer(hFile, position, nullptr, FILE_BEGIN) == INVALID_SET_FILE_POINTER) || !ReadFile(hFile, data, length, &cbRead, nullptr))
+	{
+		std::string details = "Reading from ";
+		details += filename;
+		throw std::exception(GetMessageFromLastError(details).c_str());
+	}
+	return cbRead;
+}
+
 uint32_t ScopedFile::GetLength()
 {
 	DWORD upperSize;
@@ -1023,6 +1055,19 @@ void movefile(const std::string &from, const std::string &to)
 	}
 }
 
+// Unlike deletefile followed by movefile, there is no point at which "to" doesn't exist.
+void replacefile(const std::string &from, const std::string &to)
+{
+	if (!MoveFileEx(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		std::string details = "Moving ";
+		details += from;
+		details += " to ";
+		details += to;
+		throw std::exception(GetMessageFromLastError(details).c_str());
+	}
+}
+
 struct convert {
 	void operator()(char& c) { c = toupper((unsigned char)c); }
 };
@@ -90,6 +90,8 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
+#include <future>
 #include <iterator>
 
 
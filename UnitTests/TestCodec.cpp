@@ -0,0 +1,125 @@
+/***************************************************************************
+Copyright (c) 2020 Philip Fortier
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+***************************************************************************/
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "ResourceMap.h"
+#include "AppState.h"
+#include "Helper.h"
+#include "ResourceMapOperations.h"
+#include "ResourceSources.h"
+#include "Codec.h"
+#include "format.h"
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+    TEST_CLASS(TestCodec)
+    {
+    public:
+        TEST_METHOD(TestDCLDecodeSCI11)
+        {
+            _gameFolder = SetUpGameSCI11();
+            _CompareDCLDecoders();
+        }
+
+        TEST_METHOD(TestDCLDecodeSCI0)
+        {
+            // There are no DCL resources in SCI0 games, so this just checks that nothing goes wrong.
+            _gameFolder = SetUpGameSCI0();
+            _CompareDCLDecoders();
+        }
+
+        TEST_METHOD_CLEANUP(TestCodec_Clean)
+        {
+            CleanUpGame(_gameFolder);
+        }
+
+    private:
+        struct PackedResource
+        {
+            std::vector<uint8_t> Data;
+            uint32_t UnpackedSize;
+        };
+
+        // The DCL compressed resources in the game's volumes, as they're stored.
+        std::vector<PackedResource> _GetDCLResources()
+        {
+            std::vector<PackedResource> resources;
+            std::unique_ptr<ResourceSource> resourceSource = CreateResourceSource(ResourceTypeFlags::All, appState->GetResourceMap().Helper(), ResourceSourceFlags::ResourceMap);
+            IteratorState state;
+            ResourceMapEntryAgnostic entry;
+            while (resourceSource->ReadNextEntry(ResourceTypeFlags::All, state, entry, nullptr))
+            {
+                ResourceHeaderAgnostic header;
+                sci::istream stream = resourceSource->GetHeaderAndPositionedStream(entry, header);
+                if (VersionAndCompressionNumberToAlgorithm(header.Version, header.CompressionMethod) == DecompressionAlgorithm::DCL)
+                {
+                    PackedResource resource;
+                    resource.UnpackedSize = header.cbDecompressed;
+                    resource.Data.resize(header.cbCompressed);
+                    stream.read_data(&resource.Data[0], header.cbCompressed);
+                    Assert::IsTrue(stream.good());
+                    resources.push_back(std::move(resource));
+                }
+            }
+            return resources;
+        }
+
+        // Checks the table-driven decoder against the original one, and logs how fast each is.
+        void _CompareDCLDecoders()
+        {
+            std::vector<PackedResource> resources = _GetDCLResources();
+            const int Iterations = 10;
+            double seconds = 0.0;
+            double referenceSeconds = 0.0;
+            size_t totalSize = 0;
+            for (PackedResource &resource : resources)
+            {
+                std::vector<uint8_t> decompressed(resource.UnpackedSize);
+                std::vector<uint8_t> decompressedReference(resource.UnpackedSize);
+                uint32_t packedSize = (uint32_t)resource.Data.size();
+
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < Iterations; i++)
+                {
+                    Assert::IsTrue(decompressDCL(&decompressed[0], &resource.Data[0], resource.UnpackedSize, packedSize));
+                }
+                seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                // The reference decoder reads past the end.
+                resource.Data.resize(packedSize + 4);
+                start = std::chrono::steady_clock::now();
+                for (int i = 0; i < Iterations; i++)
+                {
+                    Assert::IsTrue(decompressDCLReference(&decompressedReference[0], &resource.Data[0], resource.UnpackedSize, packedSize));
+                }
+                referenceSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                Assert::IsTrue(decompressed == decompressedReference);
+                totalSize += resource.UnpackedSize * Iterations;
+            }
+
+            double megabytes = totalSize / (1024.0 * 1024.0);
+            std::string message = fmt::format("{0} DCL resources: {1:.1f}MB/s, reference {2:.1f}MB/s\n", resources.size(),
+                (seconds > 0.0) ? (megabytes / seconds) : 0.0, (referenceSeconds > 0.0) ? (megabytes / referenceSeconds) : 0.0);
+            Logger::WriteMessage(message.c_str());
+        }
+
+        static std::string _gameFolder;
+    };
+
+    std::string TestCodec::_gameFolder;
+}
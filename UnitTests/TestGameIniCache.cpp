@@ -0,0 +1,84 @@
+/***************************************************************************
+Copyright (c) 2020 Philip Fortier
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+***************************************************************************/
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "ResourceMap.h"
+#include "AppState.h"
+#include "Helper.h"
+#include "GameFolderHelper.h"
+#include "GameIniCache.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+    TEST_CLASS(TestGameIniCache)
+    {
+    public:
+        TEST_METHOD(TestParse)
+        {
+            std::string text =
+                "; comment\r\n"
+                "orphan=ignored\r\n"
+                "[Script]\r\n"
+                "n000 = Main\r\n"
+                "N001=\"Quoted\"\r\n"
+                "n000=Duplicate\r\n"
+                "n002=\r\n"
+                ";n003=Commented\r\n"
+                "\r\n"
+                "[ Game ]\n"
+                "Name=My Game\n";
+            std::unique_ptr<GameIniTable> table = GameIniTable::Parse(text.c_str(), text.size());
+
+            Assert::AreEqual(std::string("Main"), table->GetString("Script", "n000"));
+            Assert::AreEqual(std::string("Main"), table->GetString("SCRIPT", "N000"));
+            Assert::AreEqual(std::string("Quoted"), table->GetString("script", "n001"));
+            Assert::AreEqual(std::string("default"), table->GetString("Script", "n002", "default"));
+            Assert::IsNull(table->Find("Script", "n003"));
+            Assert::IsNull(table->Find("Script", "orphan"));
+            Assert::AreEqual(std::string("My Game"), table->GetString("Game", "Name"));
+        }
+
+        TEST_METHOD(TestInvalidateOnWrite)
+        {
+            _gameFolder = SetUpGameSCI0();
+            const GameFolderHelper &helper = appState->GetResourceMap().Helper();
+
+            std::shared_ptr<const GameIniTable> before = g_gameIniCache.GetTable(helper.GetGameIniFileName());
+            Assert::IsTrue(before == g_gameIniCache.GetTable(helper.GetGameIniFileName()));
+
+            helper.SetIniString("Script", "n998", "CacheTest");
+            Assert::AreEqual(std::string("CacheTest"), helper.GetIniString("Script", "n998"));
+            Assert::IsNull(before->Find("Script", "n998"));
+
+            helper.SetIniString("Script", "n998", "");
+            Assert::AreEqual(std::string("gone"), helper.GetIniString("Script", "n998", "gone"));
+        }
+
+        TEST_METHOD_CLEANUP(TestGameIniCache_Clean)
+        {
+            if (!_gameFolder.empty())
+            {
+                CleanUpGame(_gameFolder);
+                _gameFolder.clear();
+            }
+        }
+
+    private:
+        static std::string _gameFolder;
+    };
+
+    std::string TestGameIniCache::_gameFolder;
+}
@@ -0,0 +1,102 @@
+/***************************************************************************
+Copyright (c) 2020 Philip Fortier
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+***************************************************************************/
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "ResourceMap.h"
+#include "AppState.h"
+#include "Helper.h"
+#include "ResourceContainer.h"
+#include "ResourceBlob.h"
+#include "MappedFile.h"
+#include "format.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+    TEST_CLASS(TestMappedFileCache)
+    {
+    public:
+        TEST_METHOD_INITIALIZE(TestMappedFileCache_Init)
+        {
+            _gameFolder = SetUpGameSCI0();
+            g_mappedFileCache.ResetStats();
+        }
+
+        TEST_METHOD_CLEANUP(TestMappedFileCache_Clean)
+        {
+            g_mappedFileCache.SetBudget(MappedFileCache::DefaultBudget);
+            CleanUpGame(_gameFolder);
+        }
+
+        TEST_METHOD(TestEnumerationReusesFiles)
+        {
+            _EnumerateAll();
+            MappedFileCacheStats first = g_mappedFileCache.GetStats();
+            Assert::IsTrue((first.Hits + first.Misses) > 0);
+
+            // Nothing should need to be loaded again.
+            _EnumerateAll();
+            MappedFileCacheStats second = g_mappedFileCache.GetStats();
+            Assert::AreEqual(first.Misses, second.Misses);
+            Assert::IsTrue(second.Hits > first.Hits);
+
+            std::string message = fmt::format("Hits: {0} Misses: {1} Cached: {2}KB\n", second.Hits, second.Misses, second.CachedBytes / 1024);
+            Logger::WriteMessage(message.c_str());
+        }
+
+        TEST_METHOD(TestBudget)
+        {
+            std::string mapFilename = _gameFolder + "\\resource.map";
+            g_mappedFileCache.SetBudget(0);
+            g_mappedFileCache.Open(mapFilename, MappedFileMode::Copy);
+            MappedFileCacheStats stats = g_mappedFileCache.GetStats();
+            Assert::AreEqual(0ull, stats.CachedBytes);
+            Assert::IsTrue(stats.Evictions > 0);
+
+            // Nobody kept it alive, so it needs to be loaded again.
+            g_mappedFileCache.Open(mapFilename, MappedFileMode::Copy);
+            Assert::AreEqual(stats.Misses + 1, g_mappedFileCache.GetStats().Misses);
+
+            // But while someone is using it, it's shared.
+            std::shared_ptr<const MappedFile> inUse = g_mappedFileCache.Open(mapFilename, MappedFileMode::Copy);
+            Assert::IsTrue(inUse == g_mappedFileCache.Open(mapFilename, MappedFileMode::Copy));
+        }
+
+        TEST_METHOD(TestInvalidate)
+        {
+            std::string mapFilename = _gameFolder + "\\resource.map";
+            std::shared_ptr<const MappedFile> before = g_mappedFileCache.Open(mapFilename, MappedFileMode::Copy);
+            g_mappedFileCache.Invalidate(mapFilename);
+            std::shared_ptr<const MappedFile> after = g_mappedFileCache.Open(mapFilename, MappedFileMode::Copy);
+            Assert::IsTrue(before != after);
+            Assert::AreEqual(before->GetSize(), after->GetSize());
+            Assert::AreEqual(0, memcmp(before->GetData(), after->GetData(), before->GetSize()));
+        }
+
+    private:
+        void _EnumerateAll()
+        {
+            auto container = appState->GetResourceMap().Resources(ResourceTypeFlags::All, ResourceEnumFlags::MostRecentOnly | ResourceEnumFlags::AddInDefaultEnumFlags);
+            for (auto &blob : *container)
+            {
+                Assert::IsNotNull(blob.get());
+            }
+        }
+
+        static std::string _gameFolder;
+    };
+
+    std::string TestMappedFileCache::_gameFolder;
+}
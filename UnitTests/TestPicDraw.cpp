@@ -25,12 +25,16 @@ using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 #include "ResourceMapOperations.h"
 #include "PatchResourceSource.h"
 #include "PicDrawManager.h"
+#include "PicRenderService.h"
 #include "Pic.h"
+#include "PicOperations.h"
 #include "ResourceEntity.h"
 #include "ResourceSourceFlags.h"
 #include "format.h"
 #include "Helper.h"
 #include "GameFolderHelper.h"
+#include <future>
+#include <chrono>
 
 std::unique_ptr<Cel> CelFromBitmapFile(const std::string &filename)
 {
@@ -173,6 +177,275 @@ void TestPicsHelper(bool saveAndReload)
     VerifyFilesInFolder(saveAndReload, sciVersion2, folder + "\\SCI2");
 }
 
+void VerifySameBits(PicDrawManager &pdm, PicDrawManager &pdmReference, ptrdiff_t pos)
+{
+    const PicScreenFlags screens = PicScreenFlags::Visual | PicScreenFlags::Priority | PicScreenFlags::Control;
+    pdm.SeekToPos(pos);
+    pdmReference.SeekToPos(pos);
+    pdm.RefreshAllScreens(screens, PicPositionFlags::PrePlugin);
+    pdmReference.RefreshAllScreens(screens, PicPositionFlags::PrePlugin);
+    size16 size = pdm.GetPic()->Size;
+    for (PicScreen screen : { PicScreen::Visual, PicScreen::Priority, PicScreen::Control })
+    {
+        const uint8_t *bits = pdm.GetPicBits(screen, PicPosition::PrePlugin, size);
+        const uint8_t *bitsReference = pdmReference.GetPicBits(screen, PicPosition::PrePlugin, size);
+        bool same = (0 == memcmp(bits, bitsReference, size.cx * size.cy));
+        if (!same)
+        {
+            std::string message = fmt::format("Screen {0} differs at position {1}\n", (int)screen, pos);
+            Logger::WriteMessage(message.c_str());
+        }
+        Assert::IsTrue(same);
+    }
+}
+
+void VerifyCheckpointsInFolder(SCIVersion version, const std::string &folder)
+{
+    std::unique_ptr<ResourceSourceArray> mapAndVolumes = std::make_unique<ResourceSourceArray>();
+    mapAndVolumes->push_back(std::make_unique<PatchFilesResourceSource>(ResourceTypeFlags::Pic, version, folder, ResourceSourceFlags::PatchFile));
+    std::unique_ptr<ResourceContainer> resourceContainer(
+        new ResourceContainer(
+        folder,
+        move(mapAndVolumes),
+        ResourceTypeFlags::Pic,
+        ResourceEnumFlags::None,
+        nullptr)
+        );
+
+    for (auto blob : *resourceContainer)
+    {
+        std::unique_ptr<ResourceEntity> resource = CreateResourceFromResourceData(*blob);
+        const PicComponent &pic = resource->GetComponent<PicComponent>();
+        const PaletteComponent *palette = resource->TryGetComponent<PaletteComponent>();
+        PicDrawManager pdm(&pic, palette);
+        PicDrawManager pdmReference(&pic, palette);
+        pdmReference.SetCheckpointBudget(0);
+
+        // Walk backwards and forwards, so we restore from checkpoints in both directions.
+        ptrdiff_t count = (ptrdiff_t)pic.commands.size();
+        ptrdiff_t step = (std::max)((ptrdiff_t)1, count / 7);
+        VerifySameBits(pdm, pdmReference, -1);
+        for (ptrdiff_t pos = count; pos >= 0; pos -= step)
+        {
+            VerifySameBits(pdm, pdmReference, pos);
+        }
+        for (ptrdiff_t pos = step / 2; pos < count; pos += step)
+        {
+            VerifySameBits(pdm, pdmReference, pos);
+        }
+        Assert::IsTrue((count < 200) || (pdm.GetCheckpointCount() > 0));
+
+        // Edit the middle, and only what's after it needs to be redrawn.
+        if (count > 2)
+        {
+            std::unique_ptr<ResourceEntity> edited = resource->Clone();
+            PicComponent &editedPic = edited->GetComponent<PicComponent>();
+            RemoveCommand(editedPic, count / 2);
+            pdm.InvalidateFrom(count / 2);
+            pdm.SetPic(&editedPic, palette, false);
+            pdmReference.SetPic(&editedPic, palette, false);
+            pdmReference.Invalidate();
+            VerifySameBits(pdm, pdmReference, -1);
+            VerifySameBits(pdm, pdmReference, count / 2);
+        }
+    }
+}
+
+void VerifyPosFromPointInFolder(SCIVersion version, const std::string &folder)
+{
+    std::unique_ptr<ResourceSourceArray> mapAndVolumes = std::make_unique<ResourceSourceArray>();
+    mapAndVolumes->push_back(std::make_unique<PatchFilesResourceSource>(ResourceTypeFlags::Pic, version, folder, ResourceSourceFlags::PatchFile));
+    std::unique_ptr<ResourceContainer> resourceContainer(
+        new ResourceContainer(
+        folder,
+        move(mapAndVolumes),
+        ResourceTypeFlags::Pic,
+        ResourceEnumFlags::None,
+        nullptr)
+        );
+
+    for (auto blob : *resourceContainer)
+    {
+        std::unique_ptr<ResourceEntity> resource = CreateResourceFromResourceData(*blob);
+        const PicComponent &pic = resource->GetComponent<PicComponent>();
+        PicDrawManager pdm(&pic);
+        pdm.SetTrackWriters(true);
+        PicDrawManager pdmReference(&pic);
+
+        // Draw part way first, so the writers need to be filled in separately.
+        pdm.SeekToPos(pic.commands.size() / 2);
+        pdm.RefreshAllScreens(PicScreenFlags::Visual, PicPositionFlags::PrePlugin);
+        for (int y = 0; y < pic.Size.cy; y += 7)
+        {
+            for (int x = 0; x < pic.Size.cx; x += 5)
+            {
+                ptrdiff_t pos = pdm.PosFromPoint(x, y, -1);
+                ptrdiff_t posReference = pdmReference.PosFromPoint(x, y, -1);
+                if (pos != posReference)
+                {
+                    std::string message = fmt::format("({0},{1}): {2} instead of {3}\n", x, y, pos, posReference);
+                    Logger::WriteMessage(message.c_str());
+                }
+                Assert::AreEqual(posReference, pos);
+            }
+        }
+    }
+}
+
+std::vector<uint8_t> ReadWholeFile(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void VerifyRenderServiceInFolder(SCIVersion version, const std::string &folder)
+{
+    std::unique_ptr<ResourceSourceArray> mapAndVolumes = std::make_unique<ResourceSourceArray>();
+    mapAndVolumes->push_back(std::make_unique<PatchFilesResourceSource>(ResourceTypeFlags::Pic, version, folder, ResourceSourceFlags::PatchFile));
+    std::unique_ptr<ResourceContainer> resourceContainer(
+        new ResourceContainer(
+        folder,
+        move(mapAndVolumes),
+        ResourceTypeFlags::Pic,
+        ResourceEnumFlags::None,
+        nullptr)
+        );
+
+    std::vector<std::unique_ptr<ResourceEntity>> resources;
+    std::vector<PicRenderJob> jobs;
+    for (auto blob : *resourceContainer)
+    {
+        resources.push_back(CreateResourceFromResourceData(*blob));
+        jobs.push_back({ fmt::format("pic{0}", jobs.size()), &resources.back()->GetComponent<PicComponent>(), resources.back()->TryGetComponent<PaletteComponent>() });
+    }
+
+    std::string outputFolder = GetRandomTempFolder();
+    PicRenderOptions options;
+    options.Format = PicRenderFormat::Raw;
+    options.ThreadCount = 4;
+    std::vector<PicRenderResult> results = PicRenderService(options).Render(jobs, outputFolder);
+    Assert::AreEqual(jobs.size(), results.size());
+
+    std::vector<std::string> filenames;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        Assert::IsTrue(results[i].Error.empty());
+        PicDrawManager pdm(jobs[i].Pic, jobs[i].Palette);
+        size16 size = jobs[i].Pic->Size;
+        for (PicScreen screen : { PicScreen::Visual, PicScreen::Priority, PicScreen::Control })
+        {
+            std::string filename = outputFolder + "/" + jobs[i].Name + ((screen == PicScreen::Visual) ? "-vis" : ((screen == PicScreen::Priority) ? "-pri" : "-ctl")) + ".raw";
+            filenames.push_back(filename);
+            std::vector<uint8_t> rendered = ReadWholeFile(filename);
+            Assert::AreEqual((size_t)(size.cx * size.cy), rendered.size());
+
+            // The raw files are top-down.
+            const uint8_t *bits = pdm.GetPicBits(screen, PicPosition::Final, size);
+            for (int y = 0; y < size.cy; y++)
+            {
+                Assert::AreEqual(0, memcmp(&rendered[y * size.cx], bits + (size.cy - 1 - y) * size.cx, size.cx));
+            }
+        }
+    }
+
+    // One line per pic, plus the header and the total.
+    std::string reportFilename = outputFolder + "/" + PicRenderService::TimingReportFilename;
+    filenames.push_back(reportFilename);
+    std::vector<uint8_t> report = ReadWholeFile(reportFilename);
+    Assert::AreEqual(jobs.size() + 2, (size_t)std::count(report.begin(), report.end(), '\n'));
+
+    for (const std::string &filename : filenames)
+    {
+        DeleteFile(filename.c_str());
+    }
+    RemoveDirectory(outputFolder.c_str());
+}
+
+void SavePic(ResourceEntity &resource, sci::ostream &savedStream)
+{
+    std::map<BlobKey, uint32_t> propertyBag;
+    resource.WriteTo(savedStream, true, resource.ResourceNumber, propertyBag);
+}
+
+bool IsSameStream(sci::ostream &one, sci::ostream &two)
+{
+    return (one.GetDataSize() == two.GetDataSize()) &&
+        (0 == memcmp(one.GetInternalPointer(), two.GetInternalPointer(), one.GetDataSize()));
+}
+
+void VerifySharedCommandsInFolder(SCIVersion version, const std::string &folder)
+{
+    std::unique_ptr<ResourceSourceArray> mapAndVolumes = std::make_unique<ResourceSourceArray>();
+    mapAndVolumes->push_back(std::make_unique<PatchFilesResourceSource>(ResourceTypeFlags::Pic, version, folder, ResourceSourceFlags::PatchFile));
+    std::unique_ptr<ResourceContainer> resourceContainer(
+        new ResourceContainer(
+        folder,
+        move(mapAndVolumes),
+        ResourceTypeFlags::Pic,
+        ResourceEnumFlags::None,
+        nullptr)
+        );
+
+    const int Iterations = 100;
+    double seconds = 0.0;
+    for (auto blob : *resourceContainer)
+    {
+        std::unique_ptr<ResourceEntity> resource = CreateResourceFromResourceData(*blob);
+        sci::ostream original;
+        SavePic(*resource, original);
+
+        // Clones (like the undo history makes) share the palettes, priority bars and bitmaps.
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < Iterations; i++)
+        {
+            std::unique_ptr<ResourceEntity> clone = resource->Clone();
+        }
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::unique_ptr<ResourceEntity> clone = resource->Clone();
+        const PicComponent &pic = resource->GetComponent<PicComponent>();
+        PicComponent &clonePic = clone->GetComponent<PicComponent>();
+        Assert::AreEqual(pic.commands.size(), clonePic.commands.size());
+        for (size_t i = 0; i < pic.commands.size(); i++)
+        {
+            PicCommand::CommandType type = pic.commands[i].type;
+            bool hasPayload = (type == PicCommand::SetPalette) || (type == PicCommand::SetPriorityBars) || (type == PicCommand::DrawBitmap);
+            Assert::AreEqual(hasPayload, PicCommand::IsPayloadShared(pic.commands[i], clonePic.commands[i]));
+        }
+        sci::ostream cloneSaved;
+        SavePic(*clone, cloneSaved);
+        Assert::IsTrue(IsSameStream(original, cloneSaved));
+
+        // Changing the clone's shared data doesn't affect the original.
+        bool changed = false;
+        for (size_t i = 0; i < clonePic.commands.size(); i++)
+        {
+            PicCommand &command = clonePic.commands[i];
+            if (command.type == PicCommand::DrawBitmap)
+            {
+                Cel &cel = command.GetWritableCel();
+                if (!cel.Data.empty())
+                {
+                    cel.Data[0] = (uint8_t)~cel.Data[0];
+                    changed = true;
+                }
+            }
+            else if (command.type == PicCommand::SetPriorityBars)
+            {
+                command.GetWritablePriorityLines()[0]++;
+                changed = true;
+            }
+            Assert::IsFalse(changed && PicCommand::IsPayloadShared(pic.commands[i], command));
+        }
+        sci::ostream originalAfter;
+        SavePic(*resource, originalAfter);
+        Assert::IsTrue(IsSameStream(original, originalAfter));
+    }
+
+    std::string message = fmt::format("{0}: {1:.3f}ms per clone\n", folder, seconds * 1000.0 / Iterations);
+    Logger::WriteMessage(message.c_str());
+}
+
 namespace UnitTests
 {
     TEST_CLASS(TextPicDraw)
@@ -201,6 +474,49 @@ namespace UnitTests
             TestPicsHelper(false);
         }
 
+        TEST_METHOD(TestPicCheckpoints)
+        {
+            std::string folder = GetTestFileDirectory("Pics");
+            VerifyCheckpointsInFolder(sciVersion0, folder + "\\SCI0");
+            VerifyCheckpointsInFolder(sciVersion1_1, folder + "\\SCI1.1");
+        }
+
+        TEST_METHOD(TestPosFromPoint)
+        {
+            std::string folder = GetTestFileDirectory("Pics");
+            VerifyPosFromPointInFolder(sciVersion0, folder + "\\SCI0");
+        }
+
+        TEST_METHOD(TestPicRenderService)
+        {
+            std::string folder = GetTestFileDirectory("Pics");
+            VerifyRenderServiceInFolder(sciVersion0, folder + "\\SCI0");
+            VerifyRenderServiceInFolder(sciVersion1_1, folder + "\\SCI1.1");
+        }
+
+        TEST_METHOD(TestPicCommandsShareData)
+        {
+            std::string folder = GetTestFileDirectory("Pics");
+            VerifySharedCommandsInFolder(sciVersion0, folder + "\\SCI0");
+            VerifySharedCommandsInFolder(sciVersion1_1, folder + "\\SCI1.1");
+            VerifySharedCommandsInFolder(sciVersion2, folder + "\\SCI2");
+        }
+
+        TEST_METHOD(TestPicsConcurrent)
+        {
+            // Pics are drawn on several threads at once (e.g. thumbnails and the room explorer), and fills
+            // shouldn't step on each other.
+            std::vector<std::future<void>> draws;
+            for (int i = 0; i < 4; i++)
+            {
+                draws.push_back(std::async(std::launch::async, []() { TestPicsHelper(false); }));
+            }
+            for (auto &draw : draws)
+            {
+                draw.get();
+            }
+        }
+
     private:
         static Gdiplus::GdiplusStartupInput _gdiplusStartupInput;
         static ULONG_PTR _gdiplusToken;
@@ -0,0 +1,190 @@
+/***************************************************************************
+Copyright (c) 2020 Philip Fortier
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+***************************************************************************/
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "ResourceMap.h"
+#include "AppState.h"
+#include "Helper.h"
+#include "ResourceContainer.h"
+#include "ResourceEntity.h"
+#include "View.h"
+#include "PicCommands.h"
+#include "PriorityComposite.h"
+#include "format.h"
+#include <chrono>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+    TEST_CLASS(TestPriorityComposite)
+    {
+    public:
+        TEST_METHOD(TestCompositeRowKernels)
+        {
+            // Random rows of all lengths, so we hit every mix of wide, narrow and scalar pieces.
+            std::mt19937 random(1234);
+            for (int iteration = 0; iteration < 20000; iteration++)
+            {
+                int count = random() % 100;
+                bool usePriority = (random() % 2) == 0;
+                bool writePriority = (random() % 2) == 0;
+                bool sameBuffer = (random() % 2) == 0;   // Like DrawVisualBitmap does
+                bool undithered = (random() % 2) == 0;
+                uint8_t egoPriority = random() % 16;
+                uint8_t transparent = random() % 16;
+                std::vector<uint8_t> image(count + 1), display(count + 1), priority(count + 1), priorityWrite(count + 1);
+                for (int i = 0; i < count; i++)
+                {
+                    // Few colors, so lots of them are transparent.
+                    image[i] = random() % 4;
+                    display[i] = random() % 256;
+                    priority[i] = random() % 16;
+                    priorityWrite[i] = random() % 256;
+                }
+
+                std::vector<uint8_t> expectedDisplay, expectedPriority, expectedPriorityWrite;
+                int expectedFirst, expectedLast;
+                for (CompositeKernel kernel : _GetKernels())
+                {
+                    std::vector<uint8_t> displayCopy = display;
+                    std::vector<uint8_t> priorityCopy = priority;
+                    std::vector<uint8_t> priorityWriteCopy = priorityWrite;
+                    uint8_t *pwrite = writePriority ? ((sameBuffer && usePriority) ? &priorityCopy[0] : &priorityWriteCopy[0]) : nullptr;
+                    int first, last;
+                    CompositeRowWithPriority(kernel, &displayCopy[0], usePriority ? &priorityCopy[0] : nullptr, pwrite, &image[0], count, egoPriority, transparent, undithered, &first, &last);
+                    if (kernel == CompositeKernel::Scalar)
+                    {
+                        expectedDisplay = displayCopy;
+                        expectedPriority = priorityCopy;
+                        expectedPriorityWrite = priorityWriteCopy;
+                        expectedFirst = first;
+                        expectedLast = last;
+                    }
+                    else
+                    {
+                        Assert::IsTrue(expectedDisplay == displayCopy);
+                        Assert::IsTrue(expectedPriority == priorityCopy);
+                        Assert::IsTrue(expectedPriorityWrite == priorityWriteCopy);
+                        Assert::AreEqual(expectedFirst, first);
+                        Assert::AreEqual(expectedLast, last);
+                    }
+                }
+            }
+        }
+
+        TEST_METHOD(TestCompositeViewsSCI0)
+        {
+            _gameFolder = SetUpGameSCI0();
+            _CompareKernelsOnViews();
+            CleanUpGame(_gameFolder);
+        }
+
+        TEST_METHOD(TestCompositeViewsSCI11)
+        {
+            _gameFolder = SetUpGameSCI11();
+            _CompareKernelsOnViews();
+            CleanUpGame(_gameFolder);
+        }
+
+    private:
+        static std::vector<CompositeKernel> _GetKernels()
+        {
+            std::vector<CompositeKernel> kernels = { CompositeKernel::Scalar, CompositeKernel::SSE2 };
+            if (GetBestCompositeKernel() == CompositeKernel::AVX2)
+            {
+                kernels.push_back(CompositeKernel::AVX2);
+            }
+            return kernels;
+        }
+
+        // Draws every cel in the game, at a few places (some of them clipped) over a random priority
+        // screen, with each kernel. Checks they all draw the same thing, and logs how fast each is.
+        void _CompareKernelsOnViews()
+        {
+            const size16 picSize(320, 190);
+            const int PicBytes = picSize.cx * picSize.cy;
+            std::mt19937 random(5678);
+            std::vector<uint8_t> priority(PicBytes);
+            for (uint8_t &value : priority)
+            {
+                value = random() % 16;
+            }
+            std::vector<uint8_t> visual(PicBytes);
+            for (uint8_t &value : visual)
+            {
+                value = random() % 256;
+            }
+            const point16 positions[] = { point16(160, 100), point16(0, 10), point16(319, 189), point16(40, 200) };
+
+            std::vector<CompositeKernel> kernels = _GetKernels();
+            std::vector<double> seconds(kernels.size());
+            int celCount = 0;
+            auto container = appState->GetResourceMap().Resources(ResourceTypeFlags::View, ResourceEnumFlags::MostRecentOnly | ResourceEnumFlags::AddInDefaultEnumFlags);
+            for (auto &blob : *container)
+            {
+                std::unique_ptr<ResourceEntity> view = CreateResourceFromResourceData(*blob, false);
+                const RasterComponent &raster = view->GetComponent<RasterComponent>();
+                for (const Loop &loop : raster.Loops)
+                {
+                    for (const Cel &cel : loop.Cels)
+                    {
+                        if (cel.Data.empty())
+                        {
+                            continue;
+                        }
+                        celCount++;
+                        for (const point16 &position : positions)
+                        {
+                            uint8_t egoPriority = random() % 16;
+                            bool outline = (random() % 2) == 0;
+                            int xLeft = position.x - cel.size.cx / 2;
+                            int yTop = position.y - cel.size.cy + 1;
+                            std::vector<uint8_t> expected;
+                            for (size_t i = 0; i < kernels.size(); i++)
+                            {
+                                std::vector<uint8_t> display = visual;
+                                auto start = std::chrono::steady_clock::now();
+                                DrawImageWithPriority(picSize, &display[0], &priority[0], nullptr, egoPriority, xLeft, yTop, cel.size.cx, cel.size.cy, cel.GetStride(), &cel.Data[0], cel.TransparentColor, outline, false, kernels[i]);
+                                seconds[i] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                                if (i == 0)
+                                {
+                                    expected = display;
+                                }
+                                else
+                                {
+                                    Assert::IsTrue(expected == display);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            const char *names[] = { "scalar", "SSE2", "AVX2" };
+            std::string message = fmt::format("{0} cels:", celCount);
+            for (size_t i = 0; i < kernels.size(); i++)
+            {
+                message += fmt::format(" {0} {1:.2f}ms", names[(int)kernels[i]], seconds[i] * 1000.0);
+            }
+            message += "\n";
+            Logger::WriteMessage(message.c_str());
+        }
+
+        static std::string _gameFolder;
+    };
+
+    std::string TestPriorityComposite::_gameFolder;
+}
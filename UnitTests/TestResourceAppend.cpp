@@ -0,0 +1,124 @@
+/***************************************************************************
+Copyright (c) 2020 Philip Fortier
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+***************************************************************************/
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "ResourceMap.h"
+#include "AppState.h"
+#include "Helper.h"
+#include "ResourceContainer.h"
+#include "ResourceBlob.h"
+#include "format.h"
+#include "MappedFile.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+    TEST_CLASS(TestResourceAppend)
+    {
+    public:
+        TEST_CLASS_INITIALIZE(ClassSetup)
+        {
+        }
+
+        TEST_CLASS_CLEANUP(ClassCleanup)
+        {
+        }
+
+        TEST_METHOD(TestAppendSCI0)
+        {
+            _gameFolder = SetUpGameSCI0();
+            _DoIt();
+        }
+
+        TEST_METHOD(TestAppendSCI11)
+        {
+            _gameFolder = SetUpGameSCI11();
+            _DoIt();
+        }
+
+        TEST_METHOD_CLEANUP(TestAppend_Clean)
+        {
+            CleanUpGame(_gameFolder);
+        }
+
+        std::string _GetVolumeFilename(int packageNumber)
+        {
+            return fmt::format("{0}\\resource.{1:03d}", _gameFolder, packageNumber);
+        }
+
+        uint32_t _GetVolumeSize(int packageNumber)
+        {
+            ScopedFile volume(_GetVolumeFilename(packageNumber), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING);
+            return volume.GetLength();
+        }
+
+        void _DoIt()
+        {
+            // Find a view that lives in the resource map (and not in a patch file).
+            std::unique_ptr<ResourceBlob> original;
+            auto container = appState->GetResourceMap().Resources(ResourceTypeFlags::View, ResourceEnumFlags::MostRecentOnly | ResourceEnumFlags::AddInDefaultEnumFlags);
+            for (auto &blob : *container)
+            {
+                if (blob->GetSourceFlags() == ResourceSourceFlags::ResourceMap)
+                {
+                    original = std::make_unique<ResourceBlob>(*blob);
+                    break;
+                }
+            }
+            Assert::IsNotNull(original.get());
+
+            // Someone else having the volume mapped shouldn't prevent us from appending to it.
+            std::shared_ptr<const MappedFile> viewBefore = g_mappedFileCache.Open(_GetVolumeFilename(original->GetPackageHint()));
+            Assert::IsTrue(viewBefore == g_mappedFileCache.Open(_GetVolumeFilename(original->GetPackageHint())));
+
+            uint32_t sizeBefore = _GetVolumeSize(original->GetPackageHint());
+            Assert::IsTrue(SUCCEEDED(appState->GetResourceMap().AppendResource(*original)));
+            uint32_t sizeAfter = _GetVolumeSize(original->GetPackageHint());
+
+            // The volume changed, so it gets a new view. The old one still sees what it did before.
+            std::shared_ptr<const MappedFile> viewAfter = g_mappedFileCache.Open(_GetVolumeFilename(original->GetPackageHint()));
+            Assert::IsTrue(viewBefore != viewAfter);
+            Assert::AreEqual(sizeBefore, viewBefore->GetSize());
+            Assert::AreEqual(sizeAfter, viewAfter->GetSize());
+            viewBefore.reset();
+            viewAfter.reset();
+
+            // Only the new resource (plus its header and any alignment padding) should have been written to the volume.
+            Assert::IsTrue(sizeAfter > sizeBefore);
+            Assert::IsTrue((sizeAfter - sizeBefore) <= (uint32_t)(original->GetDecompressedLength() + 16));
+
+            // And the map should point to it.
+            std::unique_ptr<ResourceBlob> reloaded = appState->GetResourceMap().MostRecentResource(ResourceType::View, original->GetNumber(), false);
+            Assert::IsNotNull(reloaded.get());
+            Assert::AreEqual(original->GetDecompressedLength(), reloaded->GetDecompressedLength());
+            Assert::AreEqual(0, memcmp(original->GetData(), reloaded->GetData(), original->GetDecompressedLength()));
+
+            // Everything else should still be readable.
+            int count = 0;
+            auto containerAfter = appState->GetResourceMap().Resources(ResourceTypeFlags::View | ResourceTypeFlags::Pic, ResourceEnumFlags::MostRecentOnly | ResourceEnumFlags::AddInDefaultEnumFlags);
+            for (auto &blob : *containerAfter)
+            {
+                Assert::IsTrue(blob->GetDecompressedLength() > 0);
+                count++;
+            }
+            Assert::IsTrue(count > 0);
+        }
+
+    private:
+        static std::string _gameFolder;
+    };
+
+    std::string TestResourceAppend::_gameFolder;
+}
@@ -20,6 +20,7 @@
 #include "ResourceContainer.h"
 #include "Helper.h"
 #include "format.h"
+#include "ResourceBlob.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -48,6 +49,30 @@ namespace UnitTests
             _DoIt();
         }
 
+        TEST_METHOD(TestMostRecentResourceMatchesEnumerationSCI0)
+        {
+            _gameFolder = SetUpGameSCI0();
+            _CompareMostRecentWithEnumeration();
+        }
+
+        TEST_METHOD(TestMostRecentResourceMatchesEnumerationSCI11)
+        {
+            _gameFolder = SetUpGameSCI11();
+            _CompareMostRecentWithEnumeration();
+        }
+
+        TEST_METHOD(TestHeaderEnumerationMatchesBlobsSCI0)
+        {
+            _gameFolder = SetUpGameSCI0();
+            _CompareHeadersWithBlobs();
+        }
+
+        TEST_METHOD(TestHeaderEnumerationMatchesBlobsSCI11)
+        {
+            _gameFolder = SetUpGameSCI11();
+            _CompareHeadersWithBlobs();
+        }
+
         TEST_METHOD_CLEANUP(TestLoadResources_Clean)
         {
             CleanUpGame(_gameFolder);
@@ -70,6 +95,44 @@ namespace UnitTests
             }
         }
 
+        // MostRecentResource is answered by the resource index, so make sure it agrees with a full enumeration.
+        void _CompareMostRecentWithEnumeration()
+        {
+            ResourceTypeFlags types = ResourceTypeFlags::View | ResourceTypeFlags::Pic | ResourceTypeFlags::Script | ResourceTypeFlags::Vocab | ResourceTypeFlags::Palette;
+            auto container = appState->GetResourceMap().Resources(types, ResourceEnumFlags::MostRecentOnly | ResourceEnumFlags::AddInDefaultEnumFlags);
+            for (auto &blob : *container)
+            {
+                std::unique_ptr<ResourceBlob> mostRecent = appState->GetResourceMap().MostRecentResource(blob->GetType(), blob->GetNumber(), false);
+                Assert::IsTrue(mostRecent != nullptr);
+                Assert::AreEqual(blob->GetDecompressedLength(), mostRecent->GetDecompressedLength());
+                Assert::AreEqual(0, memcmp(blob->GetData(), mostRecent->GetData(), blob->GetDecompressedLength()));
+                Assert::IsTrue(appState->GetResourceMap().DoesResourceExist(blob->GetType(), blob->GetNumber(), nullptr, ResourceSaveLocation::Default));
+            }
+            Assert::IsFalse(appState->GetResourceMap().DoesResourceExist(ResourceType::View, 2000, nullptr, ResourceSaveLocation::Default));
+        }
+
+        // Header-only enumeration should produce the same resources, in the same order, as a full enumeration.
+        void _CompareHeadersWithBlobs()
+        {
+            ResourceEnumFlags enumFlags = ResourceEnumFlags::MostRecentOnly | ResourceEnumFlags::AddInDefaultEnumFlags;
+            auto blobContainer = appState->GetResourceMap().Resources(ResourceTypeFlags::All, enumFlags);
+            auto headerContainer = appState->GetResourceMap().Resources(ResourceTypeFlags::All, enumFlags);
+            auto headerIt = headerContainer->Headers().begin();
+            auto headerEnd = headerContainer->Headers().end();
+            for (auto &blob : *blobContainer)
+            {
+                Assert::IsTrue(headerIt != headerEnd);
+                ResourceHeaderRecord record = *headerIt;
+                Assert::IsTrue(blob->GetType() == record.Type);
+                Assert::AreEqual(blob->GetNumber(), record.GetNumber());
+                Assert::AreEqual(blob->GetBase36(), record.GetBase36());
+                Assert::AreEqual((uint32_t)blob->GetDecompressedLength(), record.cbDecompressed);
+                Assert::IsTrue(blob->GetSourceFlags() == record.SourceFlags);
+                ++headerIt;
+            }
+            Assert::IsTrue(headerIt == headerEnd);
+        }
+
     private:
         static std::string _gameFolder;
 
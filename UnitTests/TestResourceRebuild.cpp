@@ -0,0 +1,221 @@
+/***************************************************************************
+Copyright (c) 2020 Philip Fortier
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+***************************************************************************/
+#include "stdafx.h"
+#include "CppUnitTest.h"
+#include "ResourceMap.h"
+#include "AppState.h"
+#include "Helper.h"
+#include "ResourceContainer.h"
+#include "ResourceMapOperations.h"
+#include "ResourceSources.h"
+#include "Codec.h"
+#include "format.h"
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace UnitTests
+{
+    TEST_CLASS(TestResourceRebuild)
+    {
+    public:
+        TEST_CLASS_INITIALIZE(ClassSetup)
+        {
+        }
+
+        TEST_CLASS_CLEANUP(ClassCleanup)
+        {
+        }
+
+        TEST_METHOD(TestRebuildSCI0)
+        {
+            _gameFolder = SetUpGameSCI0();
+            _DoIt();
+        }
+
+        TEST_METHOD(TestRebuildSCI11)
+        {
+            _gameFolder = SetUpGameSCI11();
+            _DoIt();
+        }
+
+        TEST_METHOD(TestEncodersRoundTrip)
+        {
+            _gameFolder = SetUpGameSCI0();
+            ResourceSnapshot original = _Snapshot();
+            size_t totalSize = 0;
+            size_t compressedSizes[3] = {};
+            for (auto &resource : original)
+            {
+                std::vector<uint8_t> &data = resource.second;
+                totalSize += data.size();
+                compressedSizes[0] += _RoundTrip(data, compressLZW, decompressLZW);
+                compressedSizes[1] += _RoundTrip(data, compressHuffman, decompressHuffman);
+                compressedSizes[2] += _RoundTrip(data, compressLZW_1, decompressLZW_1);
+            }
+            std::string message = fmt::format("{0}KB: LZW {1}KB, Huffman {2}KB, LZW1 {3}KB\n", totalSize / 1024, compressedSizes[0] / 1024, compressedSizes[1] / 1024, compressedSizes[2] / 1024);
+            Logger::WriteMessage(message.c_str());
+        }
+
+        TEST_METHOD(TestDCLSCI0)
+        {
+            _gameFolder = SetUpGameSCI0();
+            _DCLRoundTripAndBenchmark();
+        }
+
+        TEST_METHOD(TestDCLSCI11)
+        {
+            _gameFolder = SetUpGameSCI11();
+            _DCLRoundTripAndBenchmark();
+        }
+
+        TEST_METHOD_CLEANUP(TestRebuild_Clean)
+        {
+            CleanUpGame(_gameFolder);
+        }
+
+        typedef std::map<uint64_t, std::vector<uint8_t>> ResourceSnapshot;
+
+        ResourceSnapshot _Snapshot()
+        {
+            ResourceSnapshot snapshot;
+            ResourceTypeFlags types = ResourceTypeFlags::View | ResourceTypeFlags::Pic | ResourceTypeFlags::Script | ResourceTypeFlags::Vocab | ResourceTypeFlags::Palette | ResourceTypeFlags::Sound | ResourceTypeFlags::Text | ResourceTypeFlags::Font;
+            auto container = appState->GetResourceMap().Resources(types, ResourceEnumFlags::MostRecentOnly | ResourceEnumFlags::AddInDefaultEnumFlags);
+            for (auto &blob : *container)
+            {
+                snapshot[GetResourceKey(blob->GetType(), blob->GetNumber(), blob->GetBase36())].assign(blob->GetData(), blob->GetData() + blob->GetDecompressedLength());
+            }
+            return snapshot;
+        }
+
+        typedef void(*CompressFunc)(const BYTE *src, int length, std::vector<BYTE> &dest);
+        typedef int(*DecompressFunc)(BYTE *dest, BYTE *src, int length, int complength);
+
+        size_t _RoundTrip(std::vector<uint8_t> &data, CompressFunc compress, DecompressFunc decompress)
+        {
+            std::vector<uint8_t> compressed;
+            compress(&data[0], (int)data.size(), compressed);
+            // Only resources that compress are stored compressed (and the decoders only handle 16 bit sizes).
+            if (compressed.size() < data.size())
+            {
+                std::vector<uint8_t> decompressed(data.size());
+                Assert::AreEqual(0, decompress(&decompressed[0], &compressed[0], (int)data.size(), (int)compressed.size()));
+                Assert::IsTrue(data == decompressed);
+            }
+            return (std::min)(compressed.size(), data.size());
+        }
+
+        // Compresses every resource with DCL at a few effort levels, in both modes, and checks they decompress
+        // to the same thing. Logs the speed and ratio of each.
+        void _DCLRoundTripAndBenchmark()
+        {
+            ResourceSnapshot original = _Snapshot();
+            Assert::IsFalse(original.empty());
+            for (bool asciiMode : { false, true })
+            {
+                for (int effort : { 1, DefaultCompressionEffort, 9 })
+                {
+                    size_t totalSize = 0;
+                    size_t compressedSize = 0;
+                    double seconds = 0.0;
+                    std::vector<uint8_t> compressed;
+                    for (auto &resource : original)
+                    {
+                        std::vector<uint8_t> &data = resource.second;
+                        auto start = std::chrono::steady_clock::now();
+                        compressDCL(&data[0], (uint32_t)data.size(), compressed, asciiMode, effort);
+                        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                        totalSize += data.size();
+                        compressedSize += compressed.size();
+
+                        // The decompressor reads a little past the end.
+                        size_t compressedLength = compressed.size();
+                        compressed.resize(compressedLength + 4);
+                        std::vector<uint8_t> decompressed(data.size());
+                        Assert::IsTrue(decompressDCL(&decompressed[0], &compressed[0], (uint32_t)data.size(), (uint32_t)compressedLength));
+                        Assert::IsTrue(data == decompressed);
+                    }
+                    std::string message = fmt::format("DCL {0} effort {1}: {2}KB -> {3}KB ({4:.1f}%) at {5:.1f}MB/s\n", asciiMode ? "ascii" : "binary", effort, totalSize / 1024, compressedSize / 1024,
+                        100.0 * compressedSize / totalSize, (seconds > 0.0) ? (totalSize / (1024.0 * 1024.0) / seconds) : 0.0);
+                    Logger::WriteMessage(message.c_str());
+                }
+            }
+        }
+
+        // Rebuilds the resource map, and logs how long it took.
+        void _Rebuild(const RebuildOptions &options, const char *description)
+        {
+            std::map<ResourceType, RebuildStats> stats;
+            std::unique_ptr<ResourceSource> resourceSource = CreateResourceSource(ResourceTypeFlags::All, appState->GetResourceMap().Helper(), ResourceSourceFlags::ResourceMap);
+
+            auto start = std::chrono::steady_clock::now();
+            resourceSource->RebuildResources(true, *resourceSource, options, stats);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            resourceSource.reset();
+            appState->GetResourceMap().PokeResourceMapReloaded();
+
+            size_t totalSize = 0;
+            size_t itemCount = 0;
+            for (const auto &stat : stats)
+            {
+                totalSize += stat.second.TotalSize;
+                itemCount += stat.second.ItemCount;
+            }
+            Assert::IsTrue(itemCount > 0);
+
+            std::string message = fmt::format("{0}: {1} resources, {2}KB in {3:.3f}s ({4:.1f}MB/s)\n", description, itemCount, totalSize / 1024, seconds, (seconds > 0.0) ? (totalSize / (1024.0 * 1024.0) / seconds) : 0.0);
+            Logger::WriteMessage(message.c_str());
+        }
+
+        void _DoIt()
+        {
+            ResourceSnapshot original = _Snapshot();
+            Assert::IsFalse(original.empty());
+
+            // Everything on the calling thread.
+            RebuildOptions sequential;
+            sequential.ThreadCount = 1;
+            _Rebuild(sequential, "Sequential");
+            Assert::IsTrue(original == _Snapshot());
+
+            // Reading ahead on worker threads, with a small window and write buffer to exercise the buffering.
+            RebuildOptions smallWindow;
+            smallWindow.ReadAheadLimit = 2;
+            smallWindow.WriteBufferSize = 1024;
+            _Rebuild(smallWindow, "Parallel, small window");
+            Assert::IsTrue(original == _Snapshot());
+
+            // Defaults
+            _Rebuild(RebuildOptions(), "Parallel");
+            Assert::IsTrue(original == _Snapshot());
+
+            // Re-compressed (LZW/Huffman for SCI0, DCL for SCI1.1)
+            RebuildOptions compressed;
+            compressed.Compression = RebuildCompression::Best;
+            _Rebuild(compressed, "Parallel, compressed");
+            Assert::IsTrue(original == _Snapshot());
+
+            RebuildOptions compressedFast;
+            compressedFast.Compression = RebuildCompression::Best;
+            compressedFast.CompressionEffort = 1;
+            _Rebuild(compressedFast, "Parallel, compressed (fastest)");
+            Assert::IsTrue(original == _Snapshot());
+        }
+
+    private:
+        static std::string _gameFolder;
+    };
+
+    std::string TestResourceRebuild::_gameFolder;
+}